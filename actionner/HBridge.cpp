@@ -1,15 +1,56 @@
 #include "HBridge.h"
 #include "arduino.h"
+#include <trace/Trace.h>
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#endif
+
+// The timer 2 overflows every 256 * 64 cycles
+#define PWM_TICK_US (clockCyclesToMicroseconds(256UL * 64))
+
+HBridge* HBridge::sInstance = nullptr;
+
+HBridge* HBridge::sPwmInstance = nullptr;
+
+#if defined(__AVR__) && defined(HBRIDGE_PWM_ISR)
+ISR(TIMER2_OVF_vect)
+{
+  HBridge::OnPwmInterrupt();
+}
+#endif
+
+#if defined(__AVR__) && defined(HBRIDGE_PCINT_ISR)
+ISR(PCINT0_vect)
+{
+  HBridge::OnPinChangeInterrupt();
+}
+
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+
+ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+#endif
 
 HBridge::HBridge(int in1,
   int in2,
   int switchLimitOpen,
-  int switchLimitClose) :
+  int switchLimitClose,
+  unsigned long maxTravelTime) :
   mIn1(in1),
   mIn2(in2),
   mSwitchLimitOpen(switchLimitOpen),
   mSwitchLimitClose(switchLimitClose),
-  mDoorState(eUnknown)
+  mDoorState(eUnknown),
+  mMotion(eUnknown),
+  mMaxTravelTime(maxTravelTime),
+  mStartTime(0),
+  mPwmPin(-1),
+  mPwmDuty(0),
+  mRampTime(0),
+  mTravelTime(0),
+  mIsFromLimit(false),
+  mTransitionIndex(0),
+  mTransitionCount(0)
 {
   pinMode(mIn1, OUTPUT);
   pinMode(mIn2, OUTPUT);
@@ -17,11 +58,25 @@ HBridge::HBridge(int in1,
   pinMode(mSwitchLimitClose, INPUT);
 
   if (IsAtSwitchLimitOpen()) {
-    mDoorState = eOpened;
+    setState(eOpened);
   }
   else if (IsAtSwitchLimitClose()) {
-    mDoorState = eClosed;
+    setState(eClosed);
+  }
+
+  // The interrupts can only call back a single instance
+  if (nullptr == sInstance
+    && isExternalInterruptFree(mSwitchLimitOpen)
+    && isExternalInterruptFree(mSwitchLimitClose)) {
+    sInstance = this;
+    attachInterrupt(digitalPinToInterrupt(mSwitchLimitOpen), onLimitChange, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(mSwitchLimitClose), onLimitChange, CHANGE);
   }
+#ifdef HBRIDGE_PCINT_ISR
+  else {
+    AttachLimitPinChange();
+  }
+#endif
 }
 
 void HBridge::Open() {
@@ -37,66 +92,287 @@ void HBridge::Stop() {
 }
 
 eDoorState HBridge::GetState() {
-  return mDoorState;
+  eDoorState state;
+  noInterrupts();
+  state = mDoorState;
+  interrupts();
+  return state;
 }
 
 bool HBridge::isProcessFinish() {
   bool isFinish(false);
-  switch (mDoorState) {
+  Handle();
+  switch (GetState()) {
   case eOpenning:
-    if (IsAtSwitchLimitOpen()) {
-      manageDoor(eStop);
-      mDoorState = eOpened;
-      isFinish = true;
-    }
-    break;
   case eClosing:
-    if (IsAtSwitchLimitClose()) {
-      manageDoor(eStop);
-      mDoorState = eClosed;
-      isFinish = true;
-    }
+  case eStopping:
+    break;
+  case eOpened:
+  case eClosed:
+  case eBlocked:
+    isFinish = true;
     break;
   default:
     manageDoor(eStop);
-    mDoorState = eUnknown;
     isFinish = true;
     break;
   }
   return isFinish;
 }
 
+void HBridge::Handle() {
+  noInterrupts();
+  // Polling when the limit switches have no interrupt
+  handleLimit();
+  if (isMoving(eOpenning) || isMoving(eClosing)) {
+    unsigned long elapsed = millis() - mStartTime;
+    bool isAtStartLimit = isMoving(eOpenning) ? IsAtSwitchLimitClose() : IsAtSwitchLimitOpen();
+    if ((0 != mMaxTravelTime && mMaxTravelTime < elapsed)
+      || (HBRIDGE_LEAVE_TIME < elapsed && isAtStartLimit)) {
+      stopMotor();
+      setState(eBlocked);
+      TRACE(TRACE_HBRIDGE_BLOCKED, elapsed);
+    }
+  }
+  interrupts();
+}
+
+bool HBridge::GetTransition(int index, sDoorTransition& transition) {
+  if (index >= mTransitionCount) {
+    return false;
+  }
+  noInterrupts();
+  index = mTransitionIndex - 1 - index;
+  if (0 > index) {
+    index += HBRIDGE_TRANSITION_COUNT;
+  }
+  transition = mTransitions[index];
+  interrupts();
+  return true;
+}
+
+bool HBridge::IsLimitInterruptEnabled() {
+  return this == sInstance;
+}
+
+bool HBridge::SetRamp(int pwmPin, eRampProfile profile, unsigned long rampTime,
+  uint8_t cruiseDuty, uint8_t creepDuty) {
+#ifdef __AVR__
+  if (TIMER2A != digitalPinToTimer(pwmPin)
+    || (nullptr != sPwmInstance && this != sPwmInstance)) {
+    return false;
+  }
+  noInterrupts();
+  mPwmPin = pwmPin;
+  mRampTime = rampTime;
+  mRamp.Configure(profile, (rampTime * 1000) / PWM_TICK_US, cruiseDuty, creepDuty);
+  mRamp.Stop();
+  mPwmDuty = 0;
+  pinMode(mPwmPin, OUTPUT);
+  digitalWrite(mPwmPin, LOW);
+  // Fast PWM at F_CPU / 64 / 256, the overflow updates the duty
+  TCCR2A = _BV(WGM21) | _BV(WGM20);
+  TCCR2B = _BV(CS22);
+  TIMSK2 = _BV(TOIE2);
+  sPwmInstance = this;
+  interrupts();
+  return true;
+#else
+  return false;
+#endif
+}
+
+unsigned long HBridge::GetTravelTime() {
+  return mTravelTime;
+}
+
+void HBridge::OnPwmInterrupt() {
+  if (nullptr != sPwmInstance) {
+    sPwmInstance->handlePwmTick();
+  }
+}
+
+bool HBridge::AttachLimitPinChange() {
+#ifdef __AVR__
+  if (nullptr == digitalPinToPCICR(mSwitchLimitOpen)
+    || nullptr == digitalPinToPCICR(mSwitchLimitClose)
+    || (nullptr != sInstance && this != sInstance)) {
+    return false;
+  }
+  int pins[] = { mSwitchLimitOpen, mSwitchLimitClose };
+  noInterrupts();
+  sInstance = this;
+  for (int pin : pins) {
+    *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+    // Drop a change latched before, the states are read by the interrupt anyway
+    PCIFR = _BV(digitalPinToPCICRbit(pin));
+    *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+  }
+  interrupts();
+  return true;
+#else
+  return false;
+#endif
+}
+
+void HBridge::OnPinChangeInterrupt() {
+  // Any pin of the port may have changed, handleLimit() reads the limits
+  if (nullptr != sInstance) {
+    sInstance->handleLimit();
+  }
+}
+
+bool HBridge::isExternalInterruptFree(int pin) {
+  if (NOT_AN_INTERRUPT == digitalPinToInterrupt(pin)) {
+    return false;
+  }
+#if defined(EIMSK) && !defined(EICRB)
+  // INTn is interrupt n on these chips, attachInterrupt() enables it: an
+  // interrupt already enabled belongs to another component.
+  if (EIMSK & _BV(digitalPinToInterrupt(pin))) {
+    TRACE(TRACE_HBRIDGE_INTERRUPT_BUSY, pin);
+    return false;
+  }
+#endif
+  return true;
+}
+
+void HBridge::handlePwmTick() {
+  uint8_t duty = mRamp.Tick();
+  if (duty != mPwmDuty) {
+    mPwmDuty = duty;
+    analogWrite(mPwmPin, duty);
+  }
+  // End of a soft stop, at once when Stop() comes before the first step of
+  // the ramp: the duty doesn't change then
+  if (eStopping == mDoorState && mRamp.IsStopped()) {
+    digitalWrite(mIn1, LOW);
+    digitalWrite(mIn2, LOW);
+    setState(eUnknown);
+  }
+}
+
 void HBridge::manageDoor(eDoorRequest requestedState) {
+  // The pins and the state shall not be changed by the limit interrupt in between
+  noInterrupts();
   switch (requestedState) {
   case eOpen:
     if (!IsAtSwitchLimitOpen()) {
-      Serial.println("Door Openning");
-      digitalWrite(mIn1, HIGH);
-      digitalWrite(mIn2, LOW);
-      mDoorState = eOpenning;
+      TRACE(TRACE_HBRIDGE_OPEN, 0);
+      mIsFromLimit = IsAtSwitchLimitClose();
+      startMotor(HIGH, LOW);
+      mMotion = eOpenning;
+      setState(eOpenning);
     }
     break;
   case eClose:
     if (!IsAtSwitchLimitClose()) {
-      Serial.println("Door Closing");
-      digitalWrite(mIn1, LOW);
-      digitalWrite(mIn2, HIGH);
-      mDoorState = eClosing;
+      TRACE(TRACE_HBRIDGE_CLOSE, 0);
+      mIsFromLimit = IsAtSwitchLimitOpen();
+      startMotor(LOW, HIGH);
+      mMotion = eClosing;
+      setState(eClosing);
     }
     break;
   default:
-    Serial.println("Door Stop");
-    digitalWrite(mIn1, LOW);
-    digitalWrite(mIn2, LOW);
-    mDoorState = eUnknown;
+    // isProcessFinish() stops again at each poll in the eUnknown state
+    if (eUnknown != mDoorState) {
+      TRACE(TRACE_HBRIDGE_STOP, mDoorState);
+    }
+    if (0 <= mPwmPin && (eOpenning == mDoorState || eClosing == mDoorState)) {
+      // The direction pins are released and the state set by the timer
+      // interrupt at the end of the ramp
+      mRamp.SoftStop();
+      setState(eStopping);
+    }
+    else {
+      // A second Stop() while stopping doesn't wait for the ramp
+      stopMotor();
+      setState(eUnknown);
+    }
   }
+  interrupts();
+}
+
+void HBridge::handleLimit() {
+  // A travel ramped down by Stop() is not a full one
+  if ((eOpenning == mDoorState && IsAtSwitchLimitOpen())
+    || (eClosing == mDoorState && IsAtSwitchLimitClose())) {
+    if (mIsFromLimit) {
+      mTravelTime = millis() - mStartTime;
+    }
+  }
+  if (isMoving(eOpenning) && IsAtSwitchLimitOpen()) {
+    stopMotor();
+    setState(eOpened);
+    TRACE(TRACE_HBRIDGE_LIMIT_OPEN, 0);
+  }
+  else if (isMoving(eClosing) && IsAtSwitchLimitClose()) {
+    stopMotor();
+    setState(eClosed);
+    TRACE(TRACE_HBRIDGE_LIMIT_CLOSE, 0);
+  }
+}
+
+void HBridge::startMotor(int in1, int in2) {
+  if (0 <= mPwmPin) {
+    mRamp.Stop();
+    mPwmDuty = 0;
+    digitalWrite(mPwmPin, LOW);
+  }
+  digitalWrite(mIn1, in1);
+  digitalWrite(mIn2, in2);
+  mStartTime = millis();
+  if (0 <= mPwmPin) {
+    // Decelerate before the limit, with a margin of 1/8 of the travel
+    unsigned long decelerateTime = mTravelTime - mTravelTime / 8;
+    uint16_t decelerateTick = 0;
+    if (mIsFromLimit && decelerateTime > mRampTime) {
+      decelerateTick = ((decelerateTime - mRampTime) * 1000) / PWM_TICK_US;
+    }
+    mRamp.Start(decelerateTick);
+  }
+}
+
+void HBridge::stopMotor() {
+  digitalWrite(mIn1, LOW);
+  digitalWrite(mIn2, LOW);
+  if (0 <= mPwmPin) {
+    mRamp.Stop();
+    mPwmDuty = 0;
+    digitalWrite(mPwmPin, LOW);
+  }
+}
+
+void HBridge::setState(eDoorState state) {
+  if (state == mDoorState) {
+    return;
+  }
+  mDoorState = state;
+  mTransitions[mTransitionIndex].time = millis();
+  mTransitions[mTransitionIndex].state = state;
+  mTransitionIndex++;
+  if (HBRIDGE_TRANSITION_COUNT <= mTransitionIndex) {
+    mTransitionIndex = 0;
+  }
+  if (HBRIDGE_TRANSITION_COUNT > mTransitionCount) {
+    mTransitionCount++;
+  }
+}
+
+// The motor runs in this direction, at full duty or ramping down
+bool HBridge::isMoving(eDoorState motion) {
+  return motion == mDoorState || (eStopping == mDoorState && motion == mMotion);
+}
+
+void HBridge::onLimitChange() {
+  sInstance->handleLimit();
 }
 
 bool HBridge::IsAtSwitchLimitOpen() {
   bool isOnSwitchLimitOpen(false);
 
   if (LOW == digitalRead(mSwitchLimitOpen)) {
-    Serial.println("LIMIT OPEN");
     isOnSwitchLimitOpen = true;
   }
 
@@ -107,7 +383,6 @@ bool HBridge::IsAtSwitchLimitClose() {
   bool isOnSwitchLimitClose(false);
 
   if (HIGH == digitalRead(mSwitchLimitClose)) {
-    Serial.println("LIMIT CLOSE");
     isOnSwitchLimitClose = true;
   }
 
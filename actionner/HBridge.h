@@ -1,21 +1,61 @@
 #ifndef H_BRIDGE_H
 #define H_BRIDGE_H
 
+#include "RampGenerator.h"
+
+// Longest travel from a limit to the other in ms, 0 disables the watchdog
+#ifndef HBRIDGE_MAX_TRAVEL_TIME
+#define HBRIDGE_MAX_TRAVEL_TIME 30000
+#endif
+
+// Time in ms for the door to release the limit switch it starts from,
+// otherwise the motor is considered stalled
+#ifndef HBRIDGE_LEAVE_TIME
+#define HBRIDGE_LEAVE_TIME 2000
+#endif
+
+// PWM duty kept at the end of a motion until the limit is reached
+#ifndef HBRIDGE_CREEP_DUTY
+#define HBRIDGE_CREEP_DUTY 96
+#endif
+
+// Number of state transitions kept
+#define HBRIDGE_TRANSITION_COUNT 4
+
 typedef enum {
   eOpenning = 0,
   eOpened,
   eClosing,
   eClosed,
   eUnknown,
+  eBlocked,
+  // Ramping down after Stop(), the limits and the watchdog are still armed
+  eStopping,
 }eDoorState;
 
+typedef struct {
+  // millis() of the transition
+  unsigned long time;
+  eDoorState state;
+}sDoorTransition;
+
+// The limit switches stop the motor from an interrupt when their pins have an
+// external interrupt not attached yet by another component, such as the DIO0
+// of an asynchronous LoRa node (pins 2 and 3 on a Uno, only one HBridge). A pin
+// found busy is traced. Otherwise they stop it from the pin change interrupts
+// when HBRIDGE_PCINT_ISR is defined for the whole build, or when Handle() or
+// isProcessFinish() polls them.
+// A motion is stopped in the eBlocked state if the door doesn't leave its start
+// limit within HBRIDGE_LEAVE_TIME or doesn't reach the other one within the
+// maximum travel time.
 class HBridge {
 
 public:
   HBridge(int in1,
     int in2,
     int switchLimitOpen,
-    int switchLimitClose);
+    int switchLimitClose,
+    unsigned long maxTravelTime = HBRIDGE_MAX_TRAVEL_TIME);
 
   virtual ~HBridge() = default;
 
@@ -29,6 +69,43 @@ public:
 
   bool isProcessFinish();
 
+  // Supervise the motion, to call periodically while the door moves
+  void Handle();
+
+  // Transitions from the newest (index 0), return false past the oldest one
+  bool GetTransition(int index, sDoorTransition& transition);
+
+  bool IsLimitInterruptEnabled();
+
+  // Drive the enable pin of the bridge with a PWM ramp: accelerate over
+  // rampTime ms, cruise, decelerate to the creep duty before the limit
+  // according to the last full travel time, ramp down on Stop(). The limits
+  // and the watchdog still stop at once. The duty is updated from the timer 2
+  // overflow interrupt (~1 kHz), so on AVR pwmPin shall be the OC2A pin (11 on
+  // a Uno) and tone() is not available. Return false if the pin can't be used.
+  // ISR(TIMER2_OVF_vect) shall call OnPwmInterrupt, it is defined by the
+  // library when HBRIDGE_PWM_ISR is defined for the whole build.
+  bool SetRamp(int pwmPin, eRampProfile profile, unsigned long rampTime,
+    uint8_t cruiseDuty = 255, uint8_t creepDuty = HBRIDGE_CREEP_DUTY);
+
+  // Last travel time from a limit to the other, in ms, 0 if unknown
+  unsigned long GetTravelTime();
+
+  // Called by the timer interrupt
+  static void OnPwmInterrupt();
+
+  // Watch the limit pins with their pin change interrupts when they can't use
+  // the external ones. ISR(PCINTn_vect) of their ports shall call
+  // OnPinChangeInterrupt, the three vectors are defined by the library and
+  // this is done by the constructor when HBRIDGE_PCINT_ISR is defined for the
+  // whole build: SoftwareSerial and other libraries defining them can't be
+  // linked then. Return false if a pin has no pin change interrupt or another
+  // HBridge uses the interrupts.
+  bool AttachLimitPinChange();
+
+  // Called by the pin change interrupts
+  static void OnPinChangeInterrupt();
+
 protected:
 
   typedef enum {
@@ -44,6 +121,28 @@ protected:
 
   void manageDoor(eDoorRequest requestedState);
 
+  // Stop when the limit of the motion is reached, interrupts disabled
+  void handleLimit();
+
+  void startMotor(int in1, int in2);
+
+  void stopMotor();
+
+  void setState(eDoorState state);
+
+  bool isMoving(eDoorState motion);
+
+  static void onLimitChange();
+
+  // The pin has an external interrupt not attached by another component
+  static bool isExternalInterruptFree(int pin);
+
+  void handlePwmTick();
+
+  static HBridge* sInstance;
+
+  static HBridge* sPwmInstance;
+
   int mIn1;
 
   int mIn2;
@@ -52,7 +151,32 @@ protected:
 
   int mSwitchLimitClose;
 
-  eDoorState mDoorState;
+  volatile eDoorState mDoorState;
+
+  // Direction of the last motion, eOpenning or eClosing, kept while stopping
+  eDoorState mMotion;
+
+  unsigned long mMaxTravelTime;
+
+  unsigned long mStartTime;
+
+  sDoorTransition mTransitions[HBRIDGE_TRANSITION_COUNT];
+
+  RampGenerator mRamp;
+
+  int mPwmPin;
+
+  uint8_t mPwmDuty;
+
+  unsigned long mRampTime;
+
+  unsigned long mTravelTime;
+
+  bool mIsFromLimit;
+
+  int mTransitionIndex;
+
+  int mTransitionCount;
 
 };
 
@@ -1,17 +1,6 @@
 #include <Arduino.h>
 #include "PushPullButton.h"
-
-#define DEBUG
-
-#ifdef DEBUG
-#define DEBUG_MSG_ONELINE(x) Serial.print(F(x))
-#define DEBUG_MSG(x) Serial.println(F(x))
-#define DEBUG_MSG_VAR(x) Serial.println(x)
-#else
-#define DEBUG_MSG(x) // define empty, so macro does nothing
-#define DEBUG_MSG_VAR(x)
-#define DEBUG_MSG_ONELINE(x)
-#endif
+#include <trace/Trace.h>
 
 PushPullButton::PushPullButton(int pin, unsigned long upTime) :
   DigitalOutput(pin),
@@ -21,7 +10,7 @@ PushPullButton::PushPullButton(int pin, unsigned long upTime) :
 void PushPullButton::Enable() {
   DigitalOutput::Enable();
   mStartTime = millis();
-  DEBUG_MSG("PushPullButton::Enable");
+  TRACE(TRACE_PUSH_PULL_BUTTON_ENABLE, mPin);
 }
 
 void PushPullButton::Handle() {
@@ -29,6 +18,6 @@ void PushPullButton::Handle() {
     && ((millis() - mStartTime) > mUpTime)) {
       DigitalOutput::Disable();
       mStartTime = 0;
-      DEBUG_MSG("PushPullButton::Disable");
+      TRACE(TRACE_PUSH_PULL_BUTTON_DISABLE, mPin);
   }
 }
@@ -0,0 +1,114 @@
+#include "RampGenerator.h"
+
+RampGenerator::RampGenerator() :
+  mTicksPerStep(1),
+  mRampStepTicks(1),
+  mCruiseDuty(255),
+  mCreepDuty(255),
+  mDuty(0),
+  mFrom(0),
+  mTo(0),
+  mStep(RAMP_TABLE_SIZE),
+  mStepTicks(0),
+  mDecelerateTick(0),
+  mTicks(0),
+  mIsStopping(false)
+{
+  Configure(eRampNone, 0, 255, 255);
+}
+
+void RampGenerator::Configure(eRampProfile profile, uint16_t rampTicks, uint8_t cruiseDuty, uint8_t creepDuty) {
+  const uint32_t n = RAMP_TABLE_SIZE;
+  if (eRampNone == profile) {
+    rampTicks = 0;
+  }
+  for (uint32_t x = 0; x <= n; x++) {
+    switch (profile) {
+    case eRampLinear:
+      mShape[x] = (255 * x) / n;
+      break;
+    case eRampSCurve:
+      // smoothstep 3x^2 - 2x^3, null slope at both ends
+      mShape[x] = (255 * x * x * (3 * n - 2 * x)) / (n * n * n);
+      break;
+    default:
+      mShape[x] = 255;
+      break;
+    }
+  }
+  mTicksPerStep = rampTicks / RAMP_TABLE_SIZE;
+  if (0 == mTicksPerStep) {
+    mTicksPerStep = 1;
+  }
+  mCruiseDuty = cruiseDuty;
+  mCreepDuty = (creepDuty < cruiseDuty) ? creepDuty : cruiseDuty;
+}
+
+void RampGenerator::Start(uint16_t decelerateTick) {
+  mDuty = 0;
+  mIsStopping = false;
+  mTicks = 0;
+  mDecelerateTick = decelerateTick;
+  rampTo(mCruiseDuty);
+}
+
+void RampGenerator::SoftStop() {
+  mIsStopping = true;
+  rampTo(0);
+}
+
+void RampGenerator::Stop() {
+  mIsStopping = true;
+  mDuty = 0;
+  mFrom = 0;
+  mTo = 0;
+  mStep = RAMP_TABLE_SIZE;
+}
+
+uint8_t RampGenerator::Tick() {
+  if (!mIsStopping && 0 != mDecelerateTick) {
+    mTicks++;
+    if (mDecelerateTick == mTicks) {
+      rampTo(mCreepDuty);
+    }
+  }
+  if (RAMP_TABLE_SIZE > mStep) {
+    mStepTicks++;
+    if (mRampStepTicks <= mStepTicks) {
+      mStepTicks = 0;
+      mStep++;
+      if (mFrom < mTo) {
+        mDuty = mFrom + (((uint16_t)(mTo - mFrom) * mShape[mStep]) / 255);
+      }
+      else {
+        mDuty = mFrom - (((uint16_t)(mFrom - mTo) * mShape[mStep]) / 255);
+      }
+    }
+  }
+  return mDuty;
+}
+
+uint8_t RampGenerator::GetDuty() const {
+  return mDuty;
+}
+
+uint8_t RampGenerator::GetShape(uint8_t step) const {
+  return mShape[step];
+}
+
+bool RampGenerator::IsStopped() const {
+  return mIsStopping && 0 == mDuty;
+}
+
+void RampGenerator::rampTo(uint8_t duty) {
+  uint8_t distance = (mDuty < duty) ? duty - mDuty : mDuty - duty;
+  mFrom = mDuty;
+  mTo = duty;
+  mStepTicks = 0;
+  mStep = (0 == distance) ? RAMP_TABLE_SIZE : 0;
+  // The whole shape, lasting in proportion to the distance
+  mRampStepTicks = ((uint32_t)mTicksPerStep * distance + 254) / 255;
+  if (0 == mRampStepTicks) {
+    mRampStepTicks = 1;
+  }
+}
@@ -0,0 +1,77 @@
+#ifndef RAMP_GENERATOR_H
+#define RAMP_GENERATOR_H
+
+#include <stdint.h>
+
+// Steps of a ramp, the shape table has one more entry
+#define RAMP_TABLE_SIZE 32
+
+typedef enum {
+  eRampNone = 0,
+  eRampLinear,
+  eRampSCurve,
+}eRampProfile;
+
+// PWM duty profile of a motion: accelerate to the cruise duty, cruise, then
+// decelerate to the creep duty until stopped, or ramp down to 0 on a soft
+// stop. Tick() is called at a fixed rate, from a timer interrupt, and only
+// reads the shape table computed by Configure().
+// It doesn't depend on Arduino, so a motion can be simulated on a host.
+class RampGenerator {
+
+public:
+  RampGenerator();
+
+  // rampTicks is the duration of a full ramp from 0 to 255
+  void Configure(eRampProfile profile, uint16_t rampTicks, uint8_t cruiseDuty, uint8_t creepDuty);
+
+  // Accelerate from 0, decelerate to the creep duty after decelerateTick
+  // ticks, 0 to cruise until stopped
+  void Start(uint16_t decelerateTick);
+
+  void SoftStop();
+
+  // Duty 0 at once
+  void Stop();
+
+  uint8_t Tick();
+
+  uint8_t GetDuty() const;
+
+  uint8_t GetShape(uint8_t step) const;
+
+  bool IsStopped() const;
+
+protected:
+  void rampTo(uint8_t duty);
+
+  uint8_t mShape[RAMP_TABLE_SIZE + 1];
+
+  // Ticks per step of a ramp from 0 to 255, and of the current ramp
+  uint16_t mTicksPerStep;
+
+  uint16_t mRampStepTicks;
+
+  uint8_t mCruiseDuty;
+
+  uint8_t mCreepDuty;
+
+  volatile uint8_t mDuty;
+
+  uint8_t mFrom;
+
+  uint8_t mTo;
+
+  uint8_t mStep;
+
+  uint16_t mStepTicks;
+
+  uint16_t mDecelerateTick;
+
+  uint16_t mTicks;
+
+  volatile bool mIsStopping;
+
+};
+
+#endif
@@ -0,0 +1,128 @@
+// Host test of LoRaHomeAirtime and of the LoRaHomeDutyCycle ledger.
+// The time on air is checked against reference values of LoRaWAN frames at 125 kHz, CR 4/5, 8 preamble symbols,
+// then against the floating point formula of Semtech AN1200.13 for every setting and payload length.
+// The ledger is checked on its budget, the expiry of its buckets and the wraparound of millis().
+// Build and run from this directory:
+//   g++ -O2 -I.. AirtimeTest.cpp ../loRaOverlay/LoRaHomeAirtime.cpp ../loRaOverlay/LoRaHomeDutyCycle.cpp -o airtime && ./airtime
+#include <loRaOverlay/LoRaHomeAirtime.h>
+#include <loRaOverlay/LoRaHomeDutyCycle.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+
+static unsigned int sErrors = 0;
+
+static void check(bool isOk, const char *what, double value, double expected)
+{
+    if (!isOk)
+    {
+        printf("FAIL %s: %.3f, expected %.3f\n", what, value, expected);
+        sErrors++;
+    }
+}
+
+// Semtech AN1200.13, in floating point
+static double referenceTimeOnAirUs(int sf, double bw, int cr, bool crc, int preamble, int length, bool implicitHeader)
+{
+    double symbol = pow(2, sf) / bw * 1e6;
+    int de = (symbol > 16000) ? 1 : 0;
+    double payloadSymbols = 8 + fmax(ceil((8.0 * length - 4 * sf + 28 + 16 * crc - 20 * implicitHeader)
+                                          / (4.0 * (sf - 2 * de))) * cr, 0);
+    return (preamble + 4.25 + payloadSymbols) * symbol;
+}
+
+static void checkReferenceValues()
+{
+    // PHY payload of a LoRaWAN frame: 13 bytes of overhead, plus the application payload
+    static const struct
+    {
+        uint8_t sf;
+        uint8_t length;
+        double timeOnAirMs;
+    } references[] = {
+        { 7, 13, 46.336 }, { 7, 64, 118.016 }, { 9, 13, 164.864 }, { 10, 64, 698.368 },
+        { 12, 13, 1155.072 }, { 12, 64, 2793.472 },
+    };
+    for (const auto& reference : references)
+    {
+        double us = LoRaHomeAirtime::getTimeOnAirUs(reference.sf, 125000, 5, true, 8, reference.length);
+        check(fabs(us / 1000 - reference.timeOnAirMs) < 0.001, "reference time on air", us / 1000, reference.timeOnAirMs);
+        uint32_t ms = LoRaHomeAirtime::getTimeOnAirMs(reference.sf, 125000, 5, true, 8, reference.length);
+        check(ms == (uint32_t)ceil(reference.timeOnAirMs), "time on air rounded up", ms, ceil(reference.timeOnAirMs));
+    }
+}
+
+static void checkFormula()
+{
+    static const uint32_t bandwidths[] = { 7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000 };
+    unsigned long count(0);
+    for (int sf = 6; sf <= 12; sf++)
+    {
+        for (uint32_t bw : bandwidths)
+        {
+            for (int cr = 5; cr <= 8; cr++)
+            {
+                for (int flags = 0; flags < 4; flags++)
+                {
+                    for (int length = 0; length < 256; length++)
+                    {
+                        bool crc = flags & 1;
+                        bool implicitHeader = flags & 2;
+                        uint32_t us = LoRaHomeAirtime::getTimeOnAirUs(sf, bw, cr, crc, 8, length, implicitHeader);
+                        double expected = referenceTimeOnAirUs(sf, bw, cr, crc, 8, length, implicitHeader);
+                        // the integer result is truncated to the us
+                        check((us <= expected + 1e-6) && (expected - us < 1), "time on air", us, expected);
+                        count++;
+                    }
+                }
+            }
+        }
+    }
+    printf("time on air: %lu settings checked against the datasheet formula\n", count);
+}
+
+static void checkDutyCycle()
+{
+    // 1% of one hour
+    LoRaHomeDutyCycle ledger(10);
+    check(36000 == ledger.getBudget(), "budget", ledger.getBudget(), 36000);
+
+    // 90 transmissions of 400 ms, one every 10 s, use the whole budget
+    unsigned long now = 0;
+    for (int i = 0; i < 90; i++, now += 10000)
+    {
+        check(ledger.canTransmit(now, 400), "transmission within the budget", ledger.getUsedAirtime(now), 400 * i);
+        ledger.record(now, 400);
+    }
+    check(!ledger.canTransmit(now, 1), "transmission over the budget", ledger.getUsedAirtime(now), 36000);
+    // the first minute expires one hour after it started
+    check(!ledger.canTransmit(3599999, 400), "bucket expired too early", ledger.getRemainingAirtime(3599999), 0);
+    check(2400 == ledger.getRemainingAirtime(3600000), "bucket expiry", ledger.getRemainingAirtime(3600000), 2400);
+    // a long silence clears every bucket
+    check(36000 == ledger.getRemainingAirtime(10 * 3600000UL), "silence", ledger.getRemainingAirtime(10 * 3600000UL), 36000);
+
+    // millis() wraps around, after 49.7 days on a 32 bits unsigned long
+    LoRaHomeDutyCycle wrapped(10);
+    unsigned long start = ULONG_MAX - 30000;
+    wrapped.record(start, 1000);
+    unsigned long afterWrap = start + 120000;
+    check(1000 == wrapped.getUsedAirtime(afterWrap), "airtime kept across the wraparound", wrapped.getUsedAirtime(afterWrap), 1000);
+    unsigned long expired = start + 3600000 + 60000;
+    check(0 == wrapped.getUsedAirtime(expired), "airtime expired across the wraparound", wrapped.getUsedAirtime(expired), 0);
+
+    // a bucket saturates instead of wrapping
+    LoRaHomeDutyCycle saturated(1000);
+    saturated.record(0, 40000);
+    saturated.record(0, 40000);
+    check(0xFFFF == saturated.getUsedAirtime(0), "bucket saturation", saturated.getUsedAirtime(0), 0xFFFF);
+    printf("duty cycle ledger: budget, expiry, wraparound and saturation checked\n");
+}
+
+int main()
+{
+    checkReferenceValues();
+    checkFormula();
+    checkDutyCycle();
+    printf("%u errors\n", sErrors);
+    return (0 == sErrors) ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+// Host benchmark of the LoRaHomeCrc16 engines: checks each engine against the legacy bit at a time
+// CRC, whole and split in two updates, then reports its throughput on full 138 bytes frames.
+// The engine is a build wide define, build and run once per engine:
+//   for e in 0 1 2 3; do
+//     g++ -O2 -DLH_CRC16_ENGINE=$e -I.. CrcBenchmark.cpp ../loRaOverlay/LoRaHomeCrc.cpp -o crc && ./crc
+//   done
+#include <loRaOverlay/LoRaHomeCrc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_CYCLE_COUNTER 1
+#endif
+
+static const unsigned int FRAME_SIZE = 138;
+static const long FRAME_COUNT = 1000000;
+
+// LoRaHomeFrame::crc16_ccitt before the engines
+static uint16_t legacyCrc16(const uint8_t *data, unsigned int length)
+{
+    uint16_t crc = LH_CRC16_INIT;
+    if (0 == length)
+    {
+        return 0;
+    }
+    for (unsigned int i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+int main()
+{
+    static const char *names[] = { "bitwise", "nibble", "table", "slice8" };
+    uint8_t buffer[300];
+    unsigned int errors(0);
+    for (int i = 0; i < 20000; i++)
+    {
+        unsigned int length = rand() % sizeof(buffer);
+        for (unsigned int j = 0; j < length; j++)
+        {
+            buffer[j] = rand();
+        }
+        uint16_t expected = legacyCrc16(buffer, length);
+        if (LoRaHomeCrc16::compute(buffer, length) != expected)
+        {
+            errors++;
+        }
+        LoRaHomeCrc16 crc;
+        unsigned int split = (0 == length) ? 0 : rand() % length;
+        crc.update(buffer, split);
+        crc.update(buffer + split, length - split);
+        if (crc.get() != expected)
+        {
+            errors++;
+        }
+    }
+
+    volatile uint16_t sink(0);
+    auto start = std::chrono::steady_clock::now();
+#ifdef HAS_CYCLE_COUNTER
+    unsigned long long startCycles = __rdtsc();
+#endif
+    for (long i = 0; i < FRAME_COUNT; i++)
+    {
+        buffer[0] = (uint8_t)i;
+        sink = sink ^ LoRaHomeCrc16::compute(buffer, FRAME_SIZE);
+    }
+#ifdef HAS_CYCLE_COUNTER
+    unsigned long long cycles = __rdtsc() - startCycles;
+#endif
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double bytes = (double)FRAME_SIZE * FRAME_COUNT;
+
+    printf("engine %-8s errors %u  %7.1f MB/s", names[LH_CRC16_ENGINE], errors, bytes / seconds / 1e6);
+#ifdef HAS_CYCLE_COUNTER
+    printf("  %.3f bytes/cycle (TSC)", bytes / cycles);
+#endif
+    printf("\n");
+    return (0 == errors) ? 0 : 1;
+}
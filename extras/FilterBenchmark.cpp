@@ -0,0 +1,118 @@
+// Host benchmark of the streaming filters of reader/Filters.h against AnalogInputFiltered, through their
+// Run()/Get() interface on a simulated analog input: noise around mid scale with a spike every 500 samples.
+// Checks each filter on known sequences, then reports the time per Run() + Get(), the size of each input
+// and the largest deviation caused by a spike. The time is measured on the host: the division by 5 of
+// AnalogInputFiltered costs far more on an AVR, where the filters only shift.
+// The Arduino core is reduced to analogRead(), defined here. Build and run from this directory:
+//   mkdir -p core && echo 'int analogRead(unsigned char pin);' > core/Arduino.h && cp core/Arduino.h core/arduino.h
+//   g++ -O2 -I.. -Icore FilterBenchmark.cpp ../reader/AnalogInputFiltered.cpp -o filters && ./filters
+#include <reader/AnalogInputFiltered.h>
+#include <reader/FilteredAnalogInput.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+static const int SAMPLE_COUNT = 4096;
+static const long RUN_COUNT = 2000000;
+static const int MID_SCALE = 512;
+
+static int sSamples[SAMPLE_COUNT];
+static int sPosition = 0;
+
+int analogRead(uint8_t pin)
+{
+    (void)pin;
+    return sSamples[(sPosition++) & (SAMPLE_COUNT - 1)];
+}
+
+static unsigned int sErrors = 0;
+
+static void check(bool isOk, const char *what, long value, long expected)
+{
+    if (!isOk)
+    {
+        printf("FAIL %s: %ld, expected %ld\n", what, value, expected);
+        sErrors++;
+    }
+}
+
+static void checkFilters()
+{
+    MedianFilter<5> median;
+    static const int values[] = { 5, 1, 9, 3, 7, 2, 8 };
+    for (int value : values)
+    {
+        median.Add(value);
+    }
+    // last 5 values sorted: 2 3 7 8 9
+    check(7 == median.Get(), "median", median.Get(), 7);
+
+    EmaFilter<3> ema;
+    ema.Add(100);
+    for (int i = 0; i < 100; i++)
+    {
+        ema.Add(200);
+    }
+    check(200 == ema.Get(), "EMA settled", ema.Get(), 200);
+
+    MovingAverageFilter<2> average;
+    average.Add(10);
+    check(10 == average.Get(), "moving average seeded", average.Get(), 10);
+    for (int value = 20; value <= 50; value += 10)
+    {
+        average.Add(value);
+    }
+    // (20 + 30 + 40 + 50) / 4
+    check(35 == average.Get(), "moving average", average.Get(), 35);
+}
+
+// time per Run() + Get() in ns, and largest deviation from mid scale
+template <class Input>
+static void benchmark(const char* name, Input& input)
+{
+    sPosition = 0;
+    int maxDeviation(0);
+    for (int i = 0; i < SAMPLE_COUNT; i++)
+    {
+        input.Run();
+        int deviation = abs(input.Get() - MID_SCALE);
+        // the first samples fill the window
+        if ((i >= 64) && (deviation > maxDeviation))
+        {
+            maxDeviation = deviation;
+        }
+    }
+    volatile long sink(0);
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < RUN_COUNT; i++)
+    {
+        input.Run();
+        sink += input.Get();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%-40s %6.2f ns %5zu bytes %5d max deviation\n", name, elapsed.count() / RUN_COUNT, sizeof(input), maxDeviation);
+}
+
+int main()
+{
+    srand(1);
+    for (int i = 0; i < SAMPLE_COUNT; i++)
+    {
+        sSamples[i] = MID_SCALE + rand() % 64 - 32 + ((0 == i % 500) ? 400 : 0);
+    }
+    checkFilters();
+
+    AnalogInputFiltered legacy(0);
+    FilteredAnalogInput<MovingAverageFilter<3> > average(0);
+    FilteredAnalogInput<MovingAverageFilter<3, int16_t, int16_t> > shortAverage(0);
+    FilteredAnalogInput<EmaFilter<3> > ema(0);
+    FilteredAnalogInput<MedianFilter<5> > median(0);
+    benchmark("AnalogInputFiltered, 5 values", legacy);
+    benchmark("MovingAverageFilter<3>, 8 values", average);
+    benchmark("MovingAverageFilter<3, int16_t, int16_t>", shortAverage);
+    benchmark("EmaFilter<3>", ema);
+    benchmark("MedianFilter<5>", median);
+
+    printf("%u errors\n", sErrors);
+    return (0 == sErrors) ? 0 : 1;
+}
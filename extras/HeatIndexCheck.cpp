@@ -0,0 +1,118 @@
+// Host check of the fixed point DHT math (reader/DHT/DHTMath) against the floating point formulas it replaces.
+// Every tenth of the DHT22 range is compared: -40.0 to 80.0 C, or the same range in F, and 0.0 to 100.0 %.
+// The heat index shall be within 0.09 C and 0.12 F of the double formula, the bounds documented in DHTMath.h,
+// except where the two sides of the switch to the Rothfusz regression are taken differently.
+// The conversions shall be the double conversion rounded to the nearest tenth.
+// Flash and cycles on the AVR are measured by the HeatIndexBenchmark example of the DHT library.
+// Build and run from this directory:
+//   g++ -O2 -I.. HeatIndexCheck.cpp ../reader/DHT/DHTMath.cpp -o heatindex && ./heatindex
+#include <reader/DHT/DHTMath.h>
+#include <math.h>
+#include <stdio.h>
+
+// DHT::computeHeatIndex before the fixed point kernel, in double. isSwitch tells whether the simple formula
+// is so close to the switch that the rounding of the fixed point kernel may pick the other equation.
+static double referenceHeatIndexF(double temperature, double percentHumidity, bool& isSwitch)
+{
+    double hi = 0.5 * (temperature + 61.0 + ((temperature - 68.0) * 1.2) + (percentHumidity * 0.094));
+    isSwitch = fabs(hi - 79) < 1e-9;
+    if (hi > 79)
+    {
+        hi = -42.379
+             + 2.04901523 * temperature
+             + 10.14333127 * percentHumidity
+             + -0.22475541 * temperature * percentHumidity
+             + -0.00683783 * pow(temperature, 2)
+             + -0.05481717 * pow(percentHumidity, 2)
+             + 0.00122874 * pow(temperature, 2) * percentHumidity
+             + 0.00085282 * temperature * pow(percentHumidity, 2)
+             + -0.00000199 * pow(temperature, 2) * pow(percentHumidity, 2);
+
+        if ((percentHumidity < 13) && (temperature >= 80.0) && (temperature <= 112.0))
+        {
+            hi -= ((13.0 - percentHumidity) * 0.25) * sqrt((17.0 - fabs(temperature - 95.0)) / 17.0);
+        }
+        else if ((percentHumidity > 85.0) && (temperature >= 80.0) && (temperature <= 87.0))
+        {
+            hi += ((percentHumidity - 85.0) * 0.1) * ((87.0 - temperature) * 0.2);
+        }
+    }
+    return hi;
+}
+
+static unsigned int checkHeatIndex(bool isFahrenheit, double bound)
+{
+    unsigned int errors(0);
+    unsigned long count(0);
+    unsigned long switchCount(0);
+    double maxError(0);
+    for (int16_t c = -400; c <= 800; c++)
+    {
+        // the same range in F, every tenth
+        int16_t t = isFahrenheit ? (int16_t)lround(c * 1.8 + 320) : c;
+        double temperatureF = isFahrenheit ? t / 10.0 : t / 10.0 * 1.8 + 32;
+        for (uint16_t h = 0; h <= 1000; h++)
+        {
+            bool isSwitch(false);
+            double expected = referenceHeatIndexF(temperatureF, h / 10.0, isSwitch);
+            if (!isFahrenheit)
+            {
+                expected = (expected - 32) / 1.8;
+            }
+            double error = fabs(dhtComputeHeatIndex(t, h, isFahrenheit) / 10.0 - expected);
+            count++;
+            if (isSwitch)
+            {
+                switchCount++;
+                continue;
+            }
+            if (error > maxError)
+            {
+                maxError = error;
+            }
+            if (error > bound)
+            {
+                if (10 > errors)
+                {
+                    printf("FAIL heat index of %d, %u: %d, expected %.3f\n", t, h, dhtComputeHeatIndex(t, h, isFahrenheit), expected * 10);
+                }
+                errors++;
+            }
+        }
+    }
+    printf("heat index in %s: %lu inputs, max error %.3f, %lu on the switch of the equations\n",
+           isFahrenheit ? "F" : "C", count, maxError, switchCount);
+    return errors;
+}
+
+static unsigned int checkConversions()
+{
+    unsigned int errors(0);
+    for (int16_t c = -400; c <= 800; c++)
+    {
+        long expected = lround(c * 1.8 + 320);
+        if (dhtConvertCtoF(c) != expected)
+        {
+            printf("FAIL C to F of %d: %d, expected %ld\n", c, dhtConvertCtoF(c), expected);
+            errors++;
+        }
+    }
+    for (int16_t f = -400; f <= 1760; f++)
+    {
+        long expected = lround((f - 320) / 1.8);
+        if (dhtConvertFtoC(f) != expected)
+        {
+            printf("FAIL F to C of %d: %d, expected %ld\n", f, dhtConvertFtoC(f), expected);
+            errors++;
+        }
+    }
+    printf("conversions: every tenth from -40.0 to 80.0 C and from -40.0 to 176.0 F checked\n");
+    return errors;
+}
+
+int main()
+{
+    unsigned int errors = checkHeatIndex(false, 0.09) + checkHeatIndex(true, 0.12) + checkConversions();
+    printf("%u errors\n", errors);
+    return (0 == errors) ? 0 : 1;
+}
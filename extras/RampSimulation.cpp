@@ -0,0 +1,94 @@
+// Host simulation of the RampGenerator of the HBridge driving a brushed DC motor, one tick per ms as the timer 2
+// overflow (~1 kHz). The motor is a first order model: 12 V supply, 1 ohm armature, a back EMF proportional to the
+// speed, a speed driven by the current against a viscous friction. Its parameters only give the order of magnitude
+// of the inrush current, they are not those of a measured motor.
+// Each profile starts with a 500 ms ramp to the full duty, decelerates to the creep duty after 3 s and is soft
+// stopped after 4 s. The peak current and the time to 90% of the full duty are reported, 12 A for a step start,
+// 4.8 A for a linear ramp and 5.3 A for an S-curve. The soft stop shall end on a stopped ramp, also when it is
+// requested before the first tick, at duty 0.
+// Build and run from this directory:
+//   g++ -O2 -I../actionner RampSimulation.cpp ../actionner/RampGenerator.cpp -o ramp && ./ramp
+#include "RampGenerator.h"
+#include <stdio.h>
+
+static const double SUPPLY_VOLTAGE = 12.0;
+static const double ARMATURE_RESISTANCE = 1.0;
+// back EMF in V per unit of speed
+static const double BACK_EMF_CONSTANT = 0.012;
+// speed change per tick, per A and per unit of speed
+static const double TORQUE_CONSTANT = 0.5;
+static const double FRICTION = 0.001;
+
+static const uint16_t RAMP_TICKS = 500;
+static const uint16_t DECELERATE_TICK = 3000;
+static const int SOFT_STOP_TICK = 4000;
+static const int SIMULATION_TICKS = 5000;
+static const uint8_t CRUISE_DUTY = 255;
+static const uint8_t CREEP_DUTY = 80;
+
+static unsigned int sErrors = 0;
+
+static void check(bool isOk, const char *what)
+{
+    if (!isOk)
+    {
+        printf("FAIL %s\n", what);
+        sErrors++;
+    }
+}
+
+static void simulate(eRampProfile profile, const char *name)
+{
+    RampGenerator ramp;
+    ramp.Configure(profile, RAMP_TICKS, CRUISE_DUTY, CREEP_DUTY);
+    ramp.Start(DECELERATE_TICK);
+    double speed(0);
+    double peakCurrent(0);
+    int fullDutyTick(-1);
+    for (int tick = 0; tick < SIMULATION_TICKS; tick++)
+    {
+        if (SOFT_STOP_TICK == tick)
+        {
+            ramp.SoftStop();
+        }
+        uint8_t duty = ramp.Tick();
+        double current = (SUPPLY_VOLTAGE * duty / 255 - BACK_EMF_CONSTANT * speed) / ARMATURE_RESISTANCE;
+        if (current > peakCurrent)
+        {
+            peakCurrent = current;
+        }
+        speed += TORQUE_CONSTANT * current - FRICTION * speed;
+        if ((0 > fullDutyTick) && (duty >= CRUISE_DUTY * 9 / 10))
+        {
+            fullDutyTick = tick;
+        }
+    }
+    printf("%-8s peak %5.2f A, 90%% of the full duty after %3d ms\n", name, peakCurrent, fullDutyTick);
+    check(ramp.IsStopped(), "soft stop not ended");
+}
+
+int main()
+{
+    RampGenerator ramp;
+    ramp.Configure(eRampSCurve, RAMP_TICKS, CRUISE_DUTY, CREEP_DUTY);
+    printf("S-curve shape:");
+    for (uint8_t step = 0; step <= RAMP_TABLE_SIZE; step += 4)
+    {
+        printf(" %u", ramp.GetShape(step));
+    }
+    printf("\n");
+
+    simulate(eRampNone, "step");
+    simulate(eRampLinear, "linear");
+    simulate(eRampSCurve, "S-curve");
+
+    // Stop() of the HBridge before the first tick of a motion
+    ramp.Start(DECELERATE_TICK);
+    ramp.SoftStop();
+    check(ramp.IsStopped(), "soft stop at duty 0 not ended at once");
+    ramp.Tick();
+    check(ramp.IsStopped() && 0 == ramp.GetDuty(), "soft stop at duty 0 restarted");
+
+    printf("%u errors\n", sErrors);
+    return (0 == sErrors) ? 0 : 1;
+}
@@ -0,0 +1,402 @@
+// Lossy link simulation of the selective acks: a node sends a backlog of frames to the real LoRaHomeGateway,
+// with stop and wait (window 1) or with LH_TX_WINDOW_SIZE frames in flight, for several frame loss rates.
+// The node is a model of the Tx window of LoRaHomeNode (fillTxWindow, handleAck, retrySendToGateway) on the
+// real RTT estimator. Both radios are half duplex: a frame is also lost when its receiver transmits meanwhile.
+// The duty cycle limit is not simulated, it caps both modes the same way.
+// Build and run from this directory, with the ArduinoJson library used by the sketches:
+//   g++ -O2 -I.. -I<ArduinoJson>/src -o sack SackSimulation.cpp
+//     ../loRaOverlay/LoRaHome{Gateway,Frame,FrameView,Dedupe,Crc,Airtime,RttEstimator,TelemetryDecoder,BatchDecoder}.cpp
+//   ./sack
+#include <loRaOverlay/LoRaHomeGateway.h>
+#include <loRaOverlay/LoRaHomeCrc.h>
+#include <loRaOverlay/LoRaHomeRttEstimator.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <vector>
+
+static const uint8_t NODE_ID = 1;
+static const uint8_t PAYLOAD_SIZE = 40;
+static const uint16_t FRAME_COUNT = 500;
+static const unsigned long MAX_DURATION = 3600000;
+
+// A frame on air, from its emitter to the other end
+struct AirFrame
+{
+    unsigned long start;
+    unsigned long end;
+    bool isLost;
+    std::vector<uint8_t> data;
+};
+
+static unsigned long getAirtime(uint8_t size)
+{
+    return LoRaHomeAirtime::getTimeOnAirMs(LORA_SPREADING_FACTOR, LORA_SIGNAL_BANDWIDTH, LORA_CODING_RATE_DENOMINATOR,
+                                           true, LORA_PREAMBLE_LENGTH, size);
+}
+
+static bool isOverlapping(const std::vector<AirFrame>& transmissions, unsigned long start, unsigned long end)
+{
+    for (const AirFrame& tx : transmissions)
+    {
+        if ((tx.start < end) && (start < tx.end))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Shared half duplex channel with independent frame losses
+class Channel
+{
+public:
+    Channel(double lossRate): mLossRate(lossRate) {}
+
+    unsigned long transmit(std::vector<AirFrame>& transmissions, unsigned long now, const uint8_t* data, uint8_t size)
+    {
+        unsigned long start = transmissions.empty() ? now : std::max(now, transmissions.back().end);
+        AirFrame frame = { start, start + getAirtime(size), rand() < mLossRate * RAND_MAX,
+                           std::vector<uint8_t>(data, data + size) };
+        transmissions.push_back(frame);
+        return frame.end;
+    }
+
+    std::vector<AirFrame> nodeTx;
+    std::vector<AirFrame> gatewayTx;
+
+private:
+    double mLossRate;
+};
+
+// Gateway radio: frames of the node are received once fully on air, unless the gateway transmitted meanwhile
+class SimRadio : public LoRaHomeRadio
+{
+public:
+    SimRadio(Channel& channel): mChannel(channel), mNow(0), mNextRx(0) {}
+
+    void setTime(unsigned long now) { mNow = now; }
+
+    uint8_t receive(uint8_t* buffer, uint8_t maxSize, int16_t& snr, int16_t& rssi) override
+    {
+        while (mNextRx < mChannel.nodeTx.size())
+        {
+            const AirFrame& frame = mChannel.nodeTx[mNextRx];
+            if (frame.end > mNow)
+            {
+                return 0;
+            }
+            mNextRx++;
+            if (!frame.isLost && !isOverlapping(mChannel.gatewayTx, frame.start, frame.end))
+            {
+                memcpy(buffer, frame.data.data(), frame.data.size());
+                snr = 50;
+                rssi = -90;
+                return (uint8_t)frame.data.size();
+            }
+        }
+        return 0;
+    }
+
+    bool send(const uint8_t* buffer, uint8_t size) override
+    {
+        mChannel.transmit(mChannel.gatewayTx, mNow, buffer, size);
+        return true;
+    }
+
+private:
+    Channel& mChannel;
+    unsigned long mNow;
+    size_t mNextRx;
+};
+
+// The capabilities a node announces in its JSON payload, set directly instead of decoding the payload
+class SimGateway : public LoRaHomeGateway
+{
+public:
+    SimGateway(LoRaHomeRadio& radio): LoRaHomeGateway(radio) {}
+
+    void setNodeCapabilities(uint8_t nodeId, uint8_t capabilities) { mNodes[nodeId].capabilities = capabilities; }
+};
+
+class Counter : public LoRaHomeGatewayListener
+{
+public:
+    void onNodeMessage(uint8_t nodeId, const LoRaHomeFrameView& frame) override { delivered++; }
+
+    uint32_t delivered = 0;
+};
+
+struct Slot
+{
+    uint16_t counter;
+    uint8_t retries;
+    bool isDone;
+    bool isAcked;
+    bool isDue;
+    bool isInBurst;
+    unsigned long sentTime;
+};
+
+// Tx window of LoRaHomeNode, fed with a backlog of FRAME_COUNT frames
+class NodeModel
+{
+public:
+    NodeModel(Channel& channel, uint8_t windowSize):
+        mChannel(channel), mWindowSize(windowSize), mGatewayCapabilities(0),
+        mAckTimeout(ACK_TIMEOUT, ACK_TIMEOUT_MIN, ACK_TIMEOUT_MAX), mTimeoutCount(0), mRetryInterval(ACK_TIMEOUT),
+        mTxCounter(0), mQueued(FRAME_COUNT), mTxEnd(0), mNextRx(0), mGivenUpCount(0), mTxCount(0) {}
+
+    bool isFinished() const { return (0 == mQueued) && mInFlight.empty(); }
+    uint32_t getGivenUpCount() const { return mGivenUpCount; }
+    uint32_t getTxCount() const { return mTxCount; }
+
+    void run(unsigned long now)
+    {
+        receiveAcks(now);
+        if (now < mTxEnd)
+        {
+            return;
+        }
+        retry(now);
+        fillWindow(now);
+    }
+
+private:
+    uint8_t getWindowSize() const { return (mGatewayCapabilities & LH_MSG_FLAG_SACK) ? mWindowSize : 1; }
+
+    bool isWaitingForBurstAck() const
+    {
+        bool isWaiting = false;
+        for (const Slot& slot : mInFlight)
+        {
+            if (slot.isInBurst)
+            {
+                return false;
+            }
+            isWaiting = isWaiting || (!slot.isDone && !slot.isDue);
+        }
+        return isWaiting;
+    }
+
+    int getNextTxIndex(size_t from) const
+    {
+        for (size_t i = from; i < mInFlight.size(); i++)
+        {
+            if (mInFlight[i].isDue)
+            {
+                return (int)i;
+            }
+        }
+        size_t index = std::max(from, mInFlight.size());
+        return ((index < getWindowSize()) && (index - mInFlight.size() < mQueued)) ? (int)index : -1;
+    }
+
+    // one frame at a time: the next one of the burst starts once this one is on air
+    void fillWindow(unsigned long now)
+    {
+        if (isWaitingForBurstAck())
+        {
+            return;
+        }
+        int index = getNextTxIndex(0);
+        if (0 > index)
+        {
+            return;
+        }
+        if ((size_t)index == mInFlight.size())
+        {
+            Slot slot = { (uint16_t)(mTxCounter + index), 0, false, false, false, false, 0 };
+            mInFlight.push_back(slot);
+            mQueued--;
+        }
+        Slot& slot = mInFlight[index];
+        bool isMore = 0 <= getNextTxIndex(index + 1);
+        uint8_t frame[LH_FRAME_HEADER_SIZE + PAYLOAD_SIZE + LH_FRAME_FOOTER_SIZE];
+        frame[LH_FRAME_INDEX_EMITTER] = NODE_ID;
+        frame[LH_FRAME_INDEX_RECIPIENT] = LH_NODE_ID_GATEWAY;
+        frame[LH_FRAME_INDEX_MESSAGE_TYPE] = LH_MSG_TYPE_NODE_MSG_ACK_REQ | (isMore ? LH_MSG_FLAG_MORE : 0);
+        frame[LH_FRAME_INDEX_NETWORK_ID] = MY_NETWORK_ID & 0xff;
+        frame[LH_FRAME_INDEX_NETWORK_ID + 1] = (MY_NETWORK_ID >> 8) & 0xff;
+        frame[LH_FRAME_INDEX_COUNTER] = slot.counter & 0xff;
+        frame[LH_FRAME_INDEX_COUNTER + 1] = (slot.counter >> 8) & 0xff;
+        frame[LH_FRAME_INDEX_PAYLOAD_SIZE] = PAYLOAD_SIZE;
+        memset(&frame[LH_FRAME_INDEX_PAYLOAD], 'x', PAYLOAD_SIZE);
+        uint16_t crc16 = LoRaHomeCrc16::compute(frame, LH_FRAME_HEADER_SIZE + PAYLOAD_SIZE);
+        frame[sizeof(frame) - 2] = crc16 & 0xff;
+        frame[sizeof(frame) - 1] = (crc16 >> 8) & 0xff;
+        mTxEnd = mChannel.transmit(mChannel.nodeTx, now, frame, sizeof(frame));
+        mTxCount++;
+        for (Slot& burstSlot : mInFlight)
+        {
+            if (burstSlot.isInBurst)
+            {
+                burstSlot.isInBurst = false;
+                burstSlot.sentTime = mTxEnd;
+            }
+        }
+        slot.isInBurst = isMore;
+        slot.isDue = false;
+        slot.retries++;
+        slot.sentTime = mTxEnd;
+    }
+
+    void retry(unsigned long now)
+    {
+        bool isDue = false;
+        for (Slot& slot : mInFlight)
+        {
+            if (!slot.isDone && !slot.isDue && (now - slot.sentTime >= mRetryInterval))
+            {
+                isDue = true;
+                scheduleRetry(slot);
+            }
+        }
+        if (isDue)
+        {
+            mTimeoutCount++;
+            release();
+            updateRetryInterval();
+        }
+    }
+
+    void scheduleRetry(Slot& slot)
+    {
+        if (slot.isDone)
+        {
+            return;
+        }
+        if (MAX_RETRY_NO_VALID_ACK <= slot.retries)
+        {
+            slot.isDone = true;
+            mGivenUpCount++;
+            mTimeoutCount = 0;
+            return;
+        }
+        slot.isDue = true;
+    }
+
+    void ack(Slot& slot, unsigned long now)
+    {
+        if (slot.isDone)
+        {
+            return;
+        }
+        slot.isDone = true;
+        slot.isAcked = true;
+        mTimeoutCount = 0;
+        if (1 == slot.retries)
+        {
+            mAckTimeout.addSample(now - slot.sentTime);
+        }
+    }
+
+    // acks fully on air while the node listened
+    void receiveAcks(unsigned long now)
+    {
+        while ((mNextRx < mChannel.gatewayTx.size()) && (mChannel.gatewayTx[mNextRx].end <= now))
+        {
+            const AirFrame& frame = mChannel.gatewayTx[mNextRx++];
+            if (!frame.isLost && !isOverlapping(mChannel.nodeTx, frame.start, frame.end))
+            {
+                handleAck(LoRaHomeFrameView(const_cast<uint8_t*>(frame.data.data()), frame.data.size()), now);
+            }
+        }
+    }
+
+    void handleAck(const LoRaHomeFrameView& ackFrame, unsigned long now)
+    {
+        mGatewayCapabilities = ackFrame.getMessageFlags();
+        int ackIndex = (int16_t)(ackFrame.getCounter() - mTxCounter);
+        int inFlight = (int)mInFlight.size();
+        if (LH_MSG_TYPE_GW_SACK == ackFrame.getMessageType())
+        {
+            uint8_t bitmap = ackFrame.getPayload()[0];
+            for (int i = 0; (i < inFlight) && (i <= ackIndex); i++)
+            {
+                ack(mInFlight[i], now);
+            }
+            for (int bit = 0; bit < 8; bit++)
+            {
+                int index = ackIndex + 1 + bit;
+                if ((bitmap & (1 << bit)) && (0 <= index) && (index < inFlight))
+                {
+                    ack(mInFlight[index], now);
+                }
+            }
+            for (Slot& slot : mInFlight)
+            {
+                scheduleRetry(slot);
+            }
+        }
+        else if ((0 <= ackIndex) && (ackIndex < inFlight))
+        {
+            ack(mInFlight[ackIndex], now);
+        }
+        release();
+        updateRetryInterval();
+    }
+
+    void release()
+    {
+        while (!mInFlight.empty() && mInFlight.front().isDone)
+        {
+            mInFlight.pop_front();
+            mTxCounter++;
+        }
+    }
+
+    void updateRetryInterval()
+    {
+        unsigned long timeout = mAckTimeout.getBackoffTimeout(mTimeoutCount);
+        mRetryInterval = timeout + rand() % (timeout / 4 + 1);
+    }
+
+    Channel& mChannel;
+    uint8_t mWindowSize;
+    uint8_t mGatewayCapabilities;
+    LoRaHomeRttEstimator mAckTimeout;
+    uint8_t mTimeoutCount;
+    unsigned long mRetryInterval;
+    uint16_t mTxCounter;
+    uint16_t mQueued;
+    std::deque<Slot> mInFlight;
+    unsigned long mTxEnd;
+    size_t mNextRx;
+    uint32_t mGivenUpCount;
+    uint32_t mTxCount;
+};
+
+int main()
+{
+    static const double lossRates[] = { 0.0, 0.05, 0.1, 0.2, 0.3 };
+    printf("SF%d, %d frames of %d bytes payload, airtime %lu ms, ack %lu ms\n", LORA_SPREADING_FACTOR, FRAME_COUNT,
+           PAYLOAD_SIZE, getAirtime(LH_FRAME_HEADER_SIZE + PAYLOAD_SIZE + LH_FRAME_FOOTER_SIZE), getAirtime(LH_FRAME_SACK_SIZE));
+    printf("loss  window  duration(s)  frames/min  delivered  given up  transmissions  duplicates\n");
+    for (double lossRate : lossRates)
+    {
+        for (uint8_t windowSize : { (uint8_t)1, (uint8_t)LH_TX_WINDOW_SIZE })
+        {
+            srand(1);
+            Channel channel(lossRate);
+            SimRadio radio(channel);
+            SimGateway gateway(radio);
+            Counter counter;
+            gateway.setListener(&counter);
+            gateway.setNodeCapabilities(NODE_ID, (1 < windowSize) ? LH_MSG_FLAG_SACK : 0);
+            NodeModel node(channel, windowSize);
+
+            unsigned long now = 0;
+            for (; !node.isFinished() && (now < MAX_DURATION); now++)
+            {
+                node.run(now);
+                radio.setTime(now);
+                gateway.process(now);
+            }
+            printf("%4.2f  %6u  %11.1f  %10.1f  %9u  %8u  %13u  %10u\n", lossRate, windowSize, now / 1000.0,
+                   counter.delivered * 60000.0 / now, counter.delivered, node.getGivenUpCount(), node.getTxCount(),
+                   gateway.getNode(NODE_ID).duplicateCount);
+        }
+    }
+    return 0;
+}
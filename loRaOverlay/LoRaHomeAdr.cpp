@@ -0,0 +1,200 @@
+#include "LoRaHomeAdr.h"
+#include "LoraConfig.h"
+
+/**
+ * @brief Construct a new LoRaHomeAdr with the initial radio settings, also used as fallback when the link is lost
+ *
+ * @param spreadingFactor initial spreading factor, 7 to 12
+ * @param txPower initial Tx power in dBm
+ * @param minTxPower lowest Tx power the ADR can select
+ * @param maxTxPower highest Tx power the ADR can select
+ */
+LoRaHomeAdr::LoRaHomeAdr(uint8_t spreadingFactor, int8_t txPower, int8_t minTxPower, int8_t maxTxPower):
+    mSpreadingFactor(spreadingFactor),
+    mTxPower(txPower),
+    mRequestedSpreadingFactor(spreadingFactor),
+    mRequestedTxPower(txPower),
+    mMinTxPower(minTxPower),
+    mMaxTxPower(maxTxPower),
+    mDefaultSpreadingFactor(spreadingFactor),
+    mDefaultTxPower(txPower),
+    mSnrSum(0),
+    mSnrCount(0),
+    mLostAckCount(0),
+    mGiveUpCount(0),
+    mIsSpreadingFactorAdjustable(false)
+{
+}
+
+/**
+ * @brief Add the SNR of an ack received from the gateway
+ *
+ * @param snr in tenths of dB
+ */
+void LoRaHomeAdr::addSnrSample(int16_t snr)
+{
+    mSnrSum += snr;
+    mSnrCount++;
+    mLostAckCount = 0;
+    mGiveUpCount = 0;
+}
+
+/**
+ * @brief Account a frame given up without ack
+ *
+ */
+void LoRaHomeAdr::addLostAck()
+{
+    if (mLostAckCount < 0xFF)
+    {
+        mLostAckCount++;
+    }
+    if (mGiveUpCount < 0xFF)
+    {
+        mGiveUpCount++;
+    }
+}
+
+/**
+ * @brief Decide whether the radio settings shall change.
+ * Lost acks make the link more robust at once. Otherwise the average link margin over
+ * LH_ADR_SAMPLE_COUNT acks moves one step up or down, outside of a +/- LH_ADR_HYSTERESIS band.
+ * No decision is taken while a requested change is not applied.
+ *
+ * @return true if a new setting is requested
+ */
+bool LoRaHomeAdr::update()
+{
+    if (isChangeRequested())
+    {
+        return false;
+    }
+    if (LH_ADR_MAX_LOST_ACKS <= mLostAckCount)
+    {
+        resetSamples();
+        return stepUp();
+    }
+    if (LH_ADR_SAMPLE_COUNT > mSnrCount)
+    {
+        return false;
+    }
+
+    int16_t margin = getLinkMargin();
+    resetSamples();
+    if (margin >= LH_ADR_HYSTERESIS)
+    {
+        return stepDown();
+    }
+    if (margin < -LH_ADR_HYSTERESIS)
+    {
+        return stepUp();
+    }
+    return false;
+}
+
+/**
+ * @brief Request the default settings when LH_ADR_FALLBACK_LOST_ACKS frames are given up in a row,
+ * whatever the pending request. They are to be applied without announce: no ack comes back anyway.
+ *
+ * @return true if the default settings are requested
+ */
+bool LoRaHomeAdr::fallback()
+{
+    if (LH_ADR_FALLBACK_LOST_ACKS > mGiveUpCount)
+    {
+        return false;
+    }
+    resetSamples();
+    mGiveUpCount = 0;
+    mRequestedSpreadingFactor = mDefaultSpreadingFactor;
+    mRequestedTxPower = mDefaultTxPower;
+    return true;
+}
+
+/**
+ * @brief Apply the requested settings, once announced to the gateway
+ *
+ */
+void LoRaHomeAdr::apply()
+{
+    mSpreadingFactor = mRequestedSpreadingFactor;
+    mTxPower = mRequestedTxPower;
+}
+
+/**
+ * @brief Get the average link margin over the current samples:
+ * SNR above the demodulation floor of the spreading factor, minus the installation margin
+ *
+ * @return int16_t margin in tenths of dB, 0 without sample
+ */
+int16_t LoRaHomeAdr::getLinkMargin() const
+{
+    if (0 == mSnrCount)
+    {
+        return 0;
+    }
+    return (int16_t)(mSnrSum / mSnrCount) - getRequiredSnr(mSpreadingFactor) - LH_ADR_INSTALLATION_MARGIN;
+}
+
+/**
+ * @brief Get the lowest SNR the radio can demodulate (SX127x datasheet)
+ *
+ * @param spreadingFactor 7 to 12
+ * @return int16_t SNR in tenths of dB
+ */
+int16_t LoRaHomeAdr::getRequiredSnr(uint8_t spreadingFactor)
+{
+    // -7.5 dB at SF7, 2.5 dB lower for each step
+    return -75 - 25 * ((int16_t)spreadingFactor - LH_ADR_MIN_SPREADING_FACTOR);
+}
+
+/**
+ * @brief Request a more robust setting: more power first, then a higher spreading factor if allowed
+ *
+ * @return true if a new setting is requested
+ */
+bool LoRaHomeAdr::stepUp()
+{
+    if (mTxPower < mMaxTxPower)
+    {
+        mRequestedTxPower = (mTxPower + LH_ADR_TX_POWER_STEP < mMaxTxPower) ? mTxPower + LH_ADR_TX_POWER_STEP : mMaxTxPower;
+        return true;
+    }
+    if (mIsSpreadingFactorAdjustable && (mSpreadingFactor < LH_ADR_MAX_SPREADING_FACTOR))
+    {
+        mRequestedSpreadingFactor = mSpreadingFactor + 1;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Request a faster setting: lower spreading factor first if allowed, then less power
+ *
+ * @return true if a new setting is requested
+ */
+bool LoRaHomeAdr::stepDown()
+{
+    if (mIsSpreadingFactorAdjustable && (mSpreadingFactor > LH_ADR_MIN_SPREADING_FACTOR))
+    {
+        mRequestedSpreadingFactor = mSpreadingFactor - 1;
+        return true;
+    }
+    if (mTxPower > mMinTxPower)
+    {
+        mRequestedTxPower = (mTxPower - LH_ADR_TX_POWER_STEP > mMinTxPower) ? mTxPower - LH_ADR_TX_POWER_STEP : mMinTxPower;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Start a new measurement period
+ *
+ */
+void LoRaHomeAdr::resetSamples()
+{
+    mSnrSum = 0;
+    mSnrCount = 0;
+    mLostAckCount = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef LORAHOMEADR_H
+#define LORAHOMEADR_H
+
+#include <stdint.h>
+
+const uint8_t LH_ADR_MIN_SPREADING_FACTOR = 7;
+const uint8_t LH_ADR_MAX_SPREADING_FACTOR = 12;
+const int8_t LH_ADR_TX_POWER_STEP = 3; // dB
+
+// Adaptive data rate: tune the spreading factor and the Tx power from the SNR of the acks received.
+// A setting change is first requested, announced to the gateway, then applied.
+// SNR and margins are in tenths of dB.
+// The spreading factor is only changed once allowed: the gateway shall receive every spreading factor.
+class LoRaHomeAdr
+{
+public:
+    LoRaHomeAdr(uint8_t spreadingFactor, int8_t txPower, int8_t minTxPower, int8_t maxTxPower);
+    virtual ~LoRaHomeAdr() = default;
+
+    void addSnrSample(int16_t snr);
+    void addLostAck();
+    bool update();
+    bool fallback();
+    void apply();
+    inline void setSpreadingFactorAdjustable(bool isAdjustable) { mIsSpreadingFactorAdjustable = isAdjustable; };
+
+    inline bool isChangeRequested() const { return (mRequestedSpreadingFactor != mSpreadingFactor) || (mRequestedTxPower != mTxPower); };
+    inline uint8_t getSpreadingFactor() const { return mSpreadingFactor; };
+    inline int8_t getTxPower() const { return mTxPower; };
+    inline uint8_t getRequestedSpreadingFactor() const { return mRequestedSpreadingFactor; };
+    inline int8_t getRequestedTxPower() const { return mRequestedTxPower; };
+    int16_t getLinkMargin() const;
+
+    static int16_t getRequiredSnr(uint8_t spreadingFactor);
+
+private:
+    bool stepUp();
+    bool stepDown();
+    void resetSamples();
+
+    uint8_t mSpreadingFactor;
+    int8_t mTxPower;
+    uint8_t mRequestedSpreadingFactor;
+    int8_t mRequestedTxPower;
+    int8_t mMinTxPower;
+    int8_t mMaxTxPower;
+    uint8_t mDefaultSpreadingFactor;
+    int8_t mDefaultTxPower;
+    int32_t mSnrSum;
+    uint8_t mSnrCount;
+    uint8_t mLostAckCount;
+    uint8_t mGiveUpCount;
+    bool mIsSpreadingFactorAdjustable;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "LoRaHomeAirtime.h"
+
+/**
+ * @brief Compute the time on air of a LoRa packet
+ *
+ * @param spreadingFactor 6 to 12
+ * @param signalBandwidth in Hz
+ * @param codingRateDenominator 5 to 8, for coding rates 4/5 to 4/8
+ * @param crc whether the payload CRC is enabled
+ * @param preambleLength number of programmed preamble symbols
+ * @param payloadLength number of bytes of the payload
+ * @param implicitHeader whether the header is implicit
+ * @return uint32_t time on air in us
+ */
+uint32_t LoRaHomeAirtime::getTimeOnAirUs(uint8_t spreadingFactor,
+                                         uint32_t signalBandwidth,
+                                         uint8_t codingRateDenominator,
+                                         bool crc,
+                                         uint16_t preambleLength,
+                                         uint8_t payloadLength,
+                                         bool implicitHeader)
+{
+    // symbol duration in us is 2^SF / BW, kept as a fraction to avoid rounding
+    uint32_t symbolNumerator = (1UL << spreadingFactor);
+    // low data rate optimization is required above 16 ms per symbol (as set by the radio driver)
+    bool lowDataRateOptimize = ((uint64_t)symbolNumerator * 1000 > (uint64_t)signalBandwidth * 16);
+
+    // payload symbols: 8 + max(ceil((8PL - 4SF + 28 + 16CRC - 20IH) / (4(SF - 2DE))) * CR, 0)
+    int32_t numerator = 8 * (int32_t)payloadLength - 4 * (int32_t)spreadingFactor + 28
+                        + (crc ? 16 : 0) - (implicitHeader ? 20 : 0);
+    int32_t denominator = 4 * ((int32_t)spreadingFactor - (lowDataRateOptimize ? 2 : 0));
+    int32_t payloadSymbols = 8;
+    if (numerator > 0)
+    {
+        payloadSymbols += ((numerator + denominator - 1) / denominator) * codingRateDenominator;
+    }
+
+    // preamble symbols: preambleLength + 4.25, everything is counted in quarters of symbol
+    uint32_t quarterSymbols = 4 * (uint32_t)preambleLength + 17 + 4 * (uint32_t)payloadSymbols;
+
+    return (uint32_t)(((uint64_t)quarterSymbols * symbolNumerator * 1000000ULL) / (4ULL * signalBandwidth));
+}
+
+/**
+ * @brief Compute the time on air of a LoRa packet, rounded up to the ms
+ *
+ * @return uint32_t time on air in ms
+ */
+uint32_t LoRaHomeAirtime::getTimeOnAirMs(uint8_t spreadingFactor,
+                                         uint32_t signalBandwidth,
+                                         uint8_t codingRateDenominator,
+                                         bool crc,
+                                         uint16_t preambleLength,
+                                         uint8_t payloadLength,
+                                         bool implicitHeader)
+{
+    uint32_t timeOnAirUs = getTimeOnAirUs(spreadingFactor, signalBandwidth, codingRateDenominator,
+                                          crc, preambleLength, payloadLength, implicitHeader);
+    return (timeOnAirUs + 999) / 1000;
+}
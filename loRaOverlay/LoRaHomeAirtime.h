@@ -0,0 +1,26 @@
+#ifndef LORAHOMEAIRTIME_H
+#define LORAHOMEAIRTIME_H
+
+#include <stdint.h>
+
+// Time on air of a LoRa packet, from the Semtech SX127x datasheet (section 4.1.1.7).
+class LoRaHomeAirtime
+{
+public:
+    static uint32_t getTimeOnAirUs(uint8_t spreadingFactor,
+                                   uint32_t signalBandwidth,
+                                   uint8_t codingRateDenominator,
+                                   bool crc,
+                                   uint16_t preambleLength,
+                                   uint8_t payloadLength,
+                                   bool implicitHeader = false);
+    static uint32_t getTimeOnAirMs(uint8_t spreadingFactor,
+                                   uint32_t signalBandwidth,
+                                   uint8_t codingRateDenominator,
+                                   bool crc,
+                                   uint16_t preambleLength,
+                                   uint8_t payloadLength,
+                                   bool implicitHeader = false);
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "LoRaHomeBatch.h"
+
+/**
+ * @brief Construct a new empty LoRaHomeBatch
+ *
+ * @param maxAge the batch shall be flushed once its oldest reading is maxAge ms old
+ */
+LoRaHomeBatch::LoRaHomeBatch(unsigned long maxAge):
+    mCount(0),
+    mSize(LH_BATCH_ENVELOPE_SIZE),
+    mMaxAge(maxAge),
+    mIsUrgent(false)
+{
+    mReadings.to<JsonArray>();
+}
+
+/**
+ * @brief Add a reading to the batch
+ *
+ * @param reading the JSON reading, copied
+ * @param now time of the reading in ms
+ * @param isUrgent the batch shall be flushed at once, e.g. an alarm
+ * @return true if the reading is added
+ * @return false if the batch is full, to be flushed before adding the reading again
+ */
+bool LoRaHomeBatch::add(const JsonDocument& reading, unsigned long now, bool isUrgent)
+{
+    size_t size = mSize + measureJson(reading) + LH_BATCH_RECORD_OVERHEAD;
+    // room is kept for the keys added by LoRaHomeNode::sendToGateway
+    if ((LH_BATCH_MAX_READINGS <= mCount) || (size + LH_BATCH_RESERVED_SIZE > LH_FRAME_MAX_PAYLOAD_SIZE))
+    {
+        return false;
+    }
+    mReadings.add(reading);
+    mTimes[mCount] = now;
+    mCount++;
+    mSize = size;
+    mIsUrgent |= isUrgent;
+    return true;
+}
+
+/**
+ * @brief Check whether the batch shall be sent now
+ *
+ * @param now current time in ms
+ * @return true if a reading is urgent, the oldest one reached the max age, or no more reading fits
+ */
+bool LoRaHomeBatch::isFlushNeeded(unsigned long now) const
+{
+    if (0 == mCount)
+    {
+        return false;
+    }
+    return mIsUrgent
+        || (now - mTimes[0] >= mMaxAge)
+        || (LH_BATCH_MAX_READINGS <= mCount)
+        || (mSize + LH_BATCH_MIN_READING_SIZE + LH_BATCH_RESERVED_SIZE > LH_FRAME_MAX_PAYLOAD_SIZE);
+}
+
+/**
+ * @brief Build the payload of the batch and empty it.
+ * Ages are computed now, the delay until the frame is actually sent is not accounted.
+ *
+ * @param payload filled with the batch envelope
+ * @param now current time in ms
+ * @return true if the payload is built
+ * @return false if the batch is empty
+ */
+bool LoRaHomeBatch::flush(JsonDocument& payload, unsigned long now)
+{
+    if (0 == mCount)
+    {
+        return false;
+    }
+    JsonArray records = payload[MSG_BATCH].to<JsonArray>();
+    JsonArray readings = mReadings.as<JsonArray>();
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        JsonArray record = records.add<JsonArray>();
+        record.add((now - mTimes[i]) / LH_BATCH_TIME_UNIT);
+        record.add(readings[i]);
+    }
+    clear();
+    return true;
+}
+
+/**
+ * @brief Remove all the readings
+ *
+ */
+void LoRaHomeBatch::clear()
+{
+    mReadings.clear();
+    mReadings.to<JsonArray>();
+    mCount = 0;
+    mSize = LH_BATCH_ENVELOPE_SIZE;
+    mIsUrgent = false;
+}
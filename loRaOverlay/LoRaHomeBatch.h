@@ -0,0 +1,42 @@
+#ifndef LORAHOMEBATCH_H
+#define LORAHOMEBATCH_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <loRaOverlay/LoRaHomeFrame.h>
+#include <loRaOverlay/LoraConfig.h>
+
+// Size of the payload envelope {"b":[]}
+const uint8_t LH_BATCH_ENVELOPE_SIZE = 8;
+// Max size of a record around its reading: [age,] with a 5 digits age
+const uint8_t LH_BATCH_RECORD_OVERHEAD = 8;
+
+// Aggregate several timestamped readings in one frame, to share the header, CRC and PHY overhead.
+// The payload is {"b":[[age,{reading}],...]} where age is the time elapsed between the reading and
+// the flush, in LH_BATCH_TIME_UNIT ms. The gateway rebuilds each reading with LoRaHomeBatchDecoder.
+class LoRaHomeBatch
+{
+public:
+    LoRaHomeBatch(unsigned long maxAge = LH_BATCH_MAX_AGE);
+    virtual ~LoRaHomeBatch() = default;
+
+    bool add(const JsonDocument& reading, unsigned long now, bool isUrgent = false);
+    bool isFlushNeeded(unsigned long now) const;
+    bool flush(JsonDocument& payload, unsigned long now);
+    void clear();
+
+    inline uint8_t getCount() const { return mCount; };
+    inline bool isEmpty() const { return 0 == mCount; };
+    inline bool isUrgent() const { return mIsUrgent; };
+
+private:
+    JsonDocument mReadings;
+    unsigned long mTimes[LH_BATCH_MAX_READINGS];
+    uint8_t mCount;
+    // projected size of the payload
+    uint8_t mSize;
+    unsigned long mMaxAge;
+    bool mIsUrgent;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#include "LoRaHomeBatchDecoder.h"
+
+/**
+ * @brief Get the number of readings in a payload
+ *
+ * @param payload payload received
+ * @return uint8_t 0 if the payload is not a batch
+ */
+uint8_t LoRaHomeBatchDecoder::getReadingCount(const JsonDocument& payload)
+{
+    return payload[MSG_BATCH].as<JsonArrayConst>().size();
+}
+
+/**
+ * @brief Extract one reading of a batch
+ *
+ * @param payload payload received
+ * @param index of the reading, from the oldest one
+ * @param reading filled with the reading
+ * @param age filled with the age of the reading when the frame was built, in ms
+ * @return true if the reading is extracted
+ * @return false if index is out of range
+ */
+bool LoRaHomeBatchDecoder::unpack(const JsonDocument& payload, uint8_t index, JsonDocument& reading, unsigned long& age)
+{
+    JsonArrayConst record = payload[MSG_BATCH][index];
+    if (record.isNull())
+    {
+        return false;
+    }
+    age = record[0].as<unsigned long>() * LH_BATCH_TIME_UNIT;
+    reading.set(record[1]);
+    return true;
+}
@@ -0,0 +1,16 @@
+#ifndef LORAHOMEBATCHDECODER_H
+#define LORAHOMEBATCHDECODER_H
+
+#include <ArduinoJson.h>
+#include <loRaOverlay/LoraConfig.h>
+
+// Gateway side of LoRaHomeBatch: extract the timestamped readings of a batch payload.
+// Arduino free, so that a host gateway can use it.
+class LoRaHomeBatchDecoder
+{
+public:
+    static uint8_t getReadingCount(const JsonDocument& payload);
+    static bool unpack(const JsonDocument& payload, uint8_t index, JsonDocument& reading, unsigned long& age);
+};
+
+#endif
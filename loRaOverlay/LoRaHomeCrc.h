@@ -0,0 +1,48 @@
+#ifndef LORAHOMECRC_H
+#define LORAHOMECRC_H
+
+#include <stdint.h>
+
+// CRC16 CCITT engines (poly 0x1021, init 0xFFFF, no reflection, no final xor).
+// All engines produce the same result, they only trade flash/RAM for speed:
+// - BITWISE: legacy bit at a time loop, no table
+// - NIBBLE: 16 entries table (32 bytes of flash), two lookups per byte
+// - TABLE: 256 entries table (512 bytes, stored in PROGMEM on AVR), one lookup per byte
+// - SLICE8: 8 x 256 entries tables (4 KB of RAM, built once), 8 bytes per step. Host side only.
+#define LH_CRC16_ENGINE_BITWISE 0
+#define LH_CRC16_ENGINE_NIBBLE 1
+#define LH_CRC16_ENGINE_TABLE 2
+#define LH_CRC16_ENGINE_SLICE8 3
+
+// Select the engine at compile time. LoRaHomeCrc.cpp is compiled on its own: LH_CRC16_ENGINE shall be
+// defined for the whole build, e.g. -DLH_CRC16_ENGINE=1. extras/CrcBenchmark.cpp compares the engines.
+#ifndef LH_CRC16_ENGINE
+#if defined(ARDUINO)
+#define LH_CRC16_ENGINE LH_CRC16_ENGINE_TABLE
+#else
+#define LH_CRC16_ENGINE LH_CRC16_ENGINE_SLICE8
+#endif
+#endif
+
+const uint16_t LH_CRC16_INIT = 0xFFFF;
+
+class LoRaHomeCrc16
+{
+public:
+    LoRaHomeCrc16();
+    virtual ~LoRaHomeCrc16() = default;
+
+    void reset();
+    void update(const uint8_t *data, unsigned int data_len);
+    void update(uint8_t data);
+    uint16_t get() const;
+
+    static uint16_t compute(const uint8_t *data, unsigned int data_len);
+    static uint16_t process(uint16_t crc, const uint8_t *data, unsigned int data_len);
+
+private:
+    uint16_t mCrc;
+    bool mHasData;
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "LoRaHomeDedupe.h"
+
+#if (LH_DEDUPE_MAX_AGE > 32) || (LH_DEDUPE_MAX_AGE < LH_TX_WINDOW_SIZE)
+#error "LH_DEDUPE_MAX_AGE shall be between LH_TX_WINDOW_SIZE and 32"
+#endif
+
+/**
+ * @brief Check whether a counter is already received, without recording it.
+ * Counters compare wraparound safe. A counter more than LH_DEDUPE_MAX_AGE behind the highest one,
+ * or received after LH_DEDUPE_TIMEOUT of silence, means the emitter restarted: it is not a duplicate.
+ *
+ * @param counter counter of the frame received
+ * @param now current time in ms
+ * @return true if the frame is a duplicate
+ */
+bool LoRaHomeDedupeWindow::isDuplicate(uint16_t counter, unsigned long now) const
+{
+    if (!isValid || (now - lastTime > LH_DEDUPE_TIMEOUT))
+    {
+        return false;
+    }
+    int16_t delta = (int16_t)(counter - highest);
+    if (0 < delta)
+    {
+        return false;
+    }
+    if (0 == delta)
+    {
+        return true;
+    }
+    uint16_t age = (uint16_t)(-delta);
+    if (age > LH_DEDUPE_MAX_AGE)
+    {
+        return false;
+    }
+    return 0 != (bitmap & ((uint32_t)1 << (age - 1)));
+}
+
+/**
+ * @brief Record a counter handled. The window restarts from it when the emitter restarted.
+ *
+ * @param counter counter of the frame handled
+ * @param now current time in ms
+ */
+void LoRaHomeDedupeWindow::record(uint16_t counter, unsigned long now)
+{
+    int16_t delta = (int16_t)(counter - highest);
+    if (!isValid || (now - lastTime > LH_DEDUPE_TIMEOUT) || (delta < -LH_DEDUPE_MAX_AGE))
+    {
+        isValid = true;
+        highest = counter;
+        bitmap = 0;
+        lastTime = now;
+        return;
+    }
+    lastTime = now;
+    if (0 < delta)
+    {
+        // slide the window, the previous highest becomes bit delta - 1
+        if (delta > LH_DEDUPE_WINDOW_SIZE)
+        {
+            bitmap = 0;
+        }
+        else if (delta == LH_DEDUPE_WINDOW_SIZE)
+        {
+            bitmap = (uint32_t)1 << (delta - 1);
+        }
+        else
+        {
+            bitmap = (bitmap << delta) | ((uint32_t)1 << (delta - 1));
+        }
+        highest = counter;
+    }
+    else if (0 > delta)
+    {
+        bitmap |= (uint32_t)1 << (-delta - 1);
+    }
+}
+
+/**
+ * @brief Get the selective ack of the counters recorded, the window shall be valid.
+ * The ack covers the 8 counters up to the highest one, so that an emitter with up to 8 frames in flight
+ * learns which ones are missing: every counter up to the cumulative ack is received or too old to be in flight.
+ *
+ * @param ackBitmap bit i set if counter cumulative + 1 + i is received
+ * @return uint16_t the cumulative ack
+ */
+uint16_t LoRaHomeDedupeWindow::getSelectiveAck(uint8_t& ackBitmap) const
+{
+    // age of the oldest missing counter, 0 if none
+    uint8_t age = 7;
+    while ((0 < age) && (bitmap & ((uint32_t)1 << (age - 1))))
+    {
+        age--;
+    }
+    ackBitmap = 0;
+    for (uint8_t i = 1; i <= age; i++)
+    {
+        // counter cumulative + 1 + i is highest - (age - i)
+        if ((i == age) || (bitmap & ((uint32_t)1 << (age - i - 1))))
+        {
+            ackBitmap |= 1 << i;
+        }
+    }
+    return highest - age - ((0 < age) ? 1 : 0);
+}
+
+/**
+ * @brief Construct a new empty LoRaHomeDedupeCache
+ *
+ */
+LoRaHomeDedupeCache::LoRaHomeDedupeCache():
+    mDuplicateCount(0)
+{
+    for (uint8_t i = 0; i < LH_DEDUPE_CACHE_SIZE; i++)
+    {
+        mEmitters[i] = 0;
+        mWindows[i].isValid = false;
+        mWindows[i].lastTime = 0;
+        mWindows[i].bitmap = 0;
+        mWindows[i].highest = 0;
+    }
+}
+
+/**
+ * @brief Find the entry of an emitter, or the entry to evict for it
+ *
+ * @param emitter node ID of the emitter
+ * @param now current time in ms
+ * @return uint8_t index of the entry
+ */
+uint8_t LoRaHomeDedupeCache::findEntry(uint8_t emitter, unsigned long now) const
+{
+    uint8_t entry(0);
+    for (uint8_t i = 0; i < LH_DEDUPE_CACHE_SIZE; i++)
+    {
+        if (mWindows[i].isValid && (mEmitters[i] == emitter))
+        {
+            return i;
+        }
+        // evict a free entry first, then the least recently used one
+        if (!mWindows[entry].isValid)
+        {
+            continue;
+        }
+        if (!mWindows[i].isValid || (now - mWindows[i].lastTime > now - mWindows[entry].lastTime))
+        {
+            entry = i;
+        }
+    }
+    return entry;
+}
+
+/**
+ * @brief Check whether a frame is already received, without recording it
+ *
+ * @param emitter node ID of the emitter
+ * @param counter counter of the frame
+ * @param now current time in ms
+ * @return true if the frame is a duplicate
+ */
+bool LoRaHomeDedupeCache::isDuplicate(uint8_t emitter, uint16_t counter, unsigned long now)
+{
+    uint8_t entry = findEntry(emitter, now);
+    if (!mWindows[entry].isValid || (mEmitters[entry] != emitter) || !mWindows[entry].isDuplicate(counter, now))
+    {
+        return false;
+    }
+    mDuplicateCount++;
+    return true;
+}
+
+/**
+ * @brief Record a frame once handled, the least recently used emitter is evicted if needed
+ *
+ * @param emitter node ID of the emitter
+ * @param counter counter of the frame
+ * @param now current time in ms
+ */
+void LoRaHomeDedupeCache::record(uint8_t emitter, uint16_t counter, unsigned long now)
+{
+    uint8_t entry = findEntry(emitter, now);
+    if (mEmitters[entry] != emitter)
+    {
+        mEmitters[entry] = emitter;
+        mWindows[entry].isValid = false;
+    }
+    mWindows[entry].record(counter, now);
+}
@@ -0,0 +1,47 @@
+#ifndef LORAHOMEDEDUPE_H
+#define LORAHOMEDEDUPE_H
+
+#include <stdint.h>
+#include <loRaOverlay/LoraConfig.h>
+
+// Number of counters tracked below the highest one received
+const uint8_t LH_DEDUPE_WINDOW_SIZE = 32;
+
+// Replay window of the counters received from one emitter.
+// Plain data, so that it can be embedded in a flat table.
+struct LoRaHomeDedupeWindow
+{
+    // time of the last frame received in ms
+    unsigned long lastTime;
+    // bit i set if counter highest - 1 - i is received
+    uint32_t bitmap;
+    uint16_t highest;
+    bool isValid;
+
+    bool isDuplicate(uint16_t counter, unsigned long now) const;
+    void record(uint16_t counter, unsigned long now);
+    uint16_t getSelectiveAck(uint8_t& ackBitmap) const;
+};
+
+// Fixed size cache of replay windows keyed on the emitter, the least recently used emitter is evicted.
+// A duplicate is a frame retransmitted because its ack was lost: it shall be acked again, not delivered again.
+// A frame is only recorded once handled, so that a frame dropped on a decoding error is handled again when retransmitted.
+class LoRaHomeDedupeCache
+{
+public:
+    LoRaHomeDedupeCache();
+    virtual ~LoRaHomeDedupeCache() = default;
+
+    bool isDuplicate(uint8_t emitter, uint16_t counter, unsigned long now);
+    void record(uint8_t emitter, uint16_t counter, unsigned long now);
+    inline uint16_t getDuplicateCount() const { return mDuplicateCount; };
+
+private:
+    uint8_t findEntry(uint8_t emitter, unsigned long now) const;
+
+    uint8_t mEmitters[LH_DEDUPE_CACHE_SIZE];
+    LoRaHomeDedupeWindow mWindows[LH_DEDUPE_CACHE_SIZE];
+    uint16_t mDuplicateCount;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "LoRaHomeDutyCycle.h"
+
+/**
+ * @brief Construct a new LoRaHomeDutyCycle ledger, without any airtime used
+ *
+ * @param dutyCyclePermille allowed airtime over one hour, in per mille (10 for 1%)
+ */
+LoRaHomeDutyCycle::LoRaHomeDutyCycle(uint16_t dutyCyclePermille):
+    mBudget(LH_DUTY_CYCLE_WINDOW / 1000 * dutyCyclePermille),
+    mCurrentBucket(0),
+    mCurrentBucketStart(0)
+{
+    for (uint8_t i = 0; i < LH_DUTY_CYCLE_BUCKET_COUNT; i++)
+    {
+        mBuckets[i] = 0;
+    }
+}
+
+/**
+ * @brief Check whether a transmission fits in the remaining budget
+ *
+ * @param now current time in ms
+ * @param airtime time on air of the transmission in ms
+ * @return true
+ * @return false if the transmission shall be deferred
+ */
+bool LoRaHomeDutyCycle::canTransmit(unsigned long now, uint32_t airtime)
+{
+    return airtime <= getRemainingAirtime(now);
+}
+
+/**
+ * @brief Account a transmission
+ *
+ * @param now current time in ms
+ * @param airtime time on air of the transmission in ms
+ */
+void LoRaHomeDutyCycle::record(unsigned long now, uint32_t airtime)
+{
+    expire(now);
+    uint32_t total = (uint32_t)mBuckets[mCurrentBucket] + airtime;
+    mBuckets[mCurrentBucket] = (total > 0xFFFF) ? 0xFFFF : (uint16_t)total;
+}
+
+/**
+ * @brief Get the airtime used during the last hour
+ *
+ * @param now current time in ms
+ * @return uint32_t airtime in ms
+ */
+uint32_t LoRaHomeDutyCycle::getUsedAirtime(unsigned long now)
+{
+    expire(now);
+    uint32_t used(0);
+    for (uint8_t i = 0; i < LH_DUTY_CYCLE_BUCKET_COUNT; i++)
+    {
+        used += mBuckets[i];
+    }
+    return used;
+}
+
+/**
+ * @brief Get the airtime that can still be used without exceeding the duty cycle
+ *
+ * @param now current time in ms
+ * @return uint32_t airtime in ms
+ */
+uint32_t LoRaHomeDutyCycle::getRemainingAirtime(unsigned long now)
+{
+    uint32_t used = getUsedAirtime(now);
+    return (used < mBudget) ? (mBudget - used) : 0;
+}
+
+/**
+ * @brief Move to the bucket of the current time, clearing the buckets older than one hour
+ *
+ * @param now current time in ms, wraparound safe
+ */
+void LoRaHomeDutyCycle::expire(unsigned long now)
+{
+    unsigned long elapsed = now - mCurrentBucketStart;
+    if (elapsed < LH_DUTY_CYCLE_BUCKET_DURATION)
+    {
+        return;
+    }
+    unsigned long elapsedBuckets = elapsed / LH_DUTY_CYCLE_BUCKET_DURATION;
+    uint8_t toClear = (elapsedBuckets < LH_DUTY_CYCLE_BUCKET_COUNT) ? elapsedBuckets : LH_DUTY_CYCLE_BUCKET_COUNT;
+    for (uint8_t i = 0; i < toClear; i++)
+    {
+        mCurrentBucket = (mCurrentBucket + 1) % LH_DUTY_CYCLE_BUCKET_COUNT;
+        mBuckets[mCurrentBucket] = 0;
+    }
+    mCurrentBucketStart += elapsedBuckets * LH_DUTY_CYCLE_BUCKET_DURATION;
+}
@@ -0,0 +1,34 @@
+#ifndef LORAHOMEDUTYCYCLE_H
+#define LORAHOMEDUTYCYCLE_H
+
+#include <stdint.h>
+
+const uint8_t LH_DUTY_CYCLE_BUCKET_COUNT = 60;
+const uint32_t LH_DUTY_CYCLE_BUCKET_DURATION = 60000; // 1 min, the window is 1 hour
+const uint32_t LH_DUTY_CYCLE_WINDOW = (uint32_t)LH_DUTY_CYCLE_BUCKET_COUNT * LH_DUTY_CYCLE_BUCKET_DURATION;
+
+// Rolling one hour ledger of the airtime used by the node, to enforce a regulatory duty cycle.
+// Airtime is accounted in ms per one minute bucket.
+class LoRaHomeDutyCycle
+{
+public:
+    LoRaHomeDutyCycle(uint16_t dutyCyclePermille);
+    virtual ~LoRaHomeDutyCycle() = default;
+
+    bool canTransmit(unsigned long now, uint32_t airtime);
+    void record(unsigned long now, uint32_t airtime);
+
+    uint32_t getUsedAirtime(unsigned long now);
+    uint32_t getRemainingAirtime(unsigned long now);
+    inline uint32_t getBudget() const { return mBudget; };
+
+private:
+    void expire(unsigned long now);
+
+    uint32_t mBudget;
+    uint16_t mBuckets[LH_DUTY_CYCLE_BUCKET_COUNT];
+    uint8_t mCurrentBucket;
+    unsigned long mCurrentBucketStart;
+};
+
+#endif
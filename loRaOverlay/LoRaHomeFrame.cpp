@@ -1,4 +1,6 @@
 #include "LoRaHomeFrame.h"
+#include "LoRaHomeCrc.h"
+#include "LoRaHomeFrameView.h"
 
 // #define DEBUG
 
@@ -22,9 +24,11 @@ LoRaHomeFrame::LoRaHomeFrame():
     mNodeIdEmitter(0),
     mNodeIdRecipient(0),
     mMessageType(0),
-    mCounter(0)
+    mMessageFlags(0),
+    mCounter(0),
+    mPayloadSize(0)
 {
-    mJsonPayload[0] = '\0';
+    mPayload[0] = '\0';
 }
 
 /**
@@ -44,10 +48,12 @@ LoRaHomeFrame::LoRaHomeFrame(uint16_t networkID,
     mNetworkID(networkID),
     mNodeIdEmitter(nodeIdEmitter),
     mNodeIdRecipient(nodeIdRecipient),
-    mMessageType(messageType),
-    mCounter(0)
+    mMessageType(messageType & LH_MSG_TYPE_MASK),
+    mMessageFlags(messageType & LH_MSG_FLAGS_MASK),
+    mCounter(0),
+    mPayloadSize(0)
 {
-    mJsonPayload[0] = '\0';
+    mPayload[0] = '\0';
 }
 
 /**
@@ -61,11 +67,48 @@ void LoRaHomeFrame::setCounter(uint16_t counter){
 
 /**
  * @brief Set the Payload object
+ * MessagePack shall only be used when the recipient advertised it (see LH_MSG_FLAG_MSGPACK)
  *
  * @param payload
+ * @param format LH_PAYLOAD_FORMAT_JSON or LH_PAYLOAD_FORMAT_MSGPACK
  */
-void LoRaHomeFrame::setPayload(const JsonDocument& payload){
-    serializeJson(payload, mJsonPayload, LH_FRAME_MAX_PAYLOAD_SIZE);
+void LoRaHomeFrame::setPayload(const JsonDocument& payload, uint8_t format){
+    if (LH_PAYLOAD_FORMAT_MSGPACK == format)
+    {
+        mPayloadSize = serializeMsgPack(payload, mPayload, LH_FRAME_MAX_PAYLOAD_SIZE);
+        mMessageFlags |= LH_MSG_FLAG_MSGPACK;
+    }
+    else
+    {
+        serializeJson(payload, mPayload, LH_FRAME_MAX_PAYLOAD_SIZE);
+        mPayloadSize = strlen(mPayload);
+        mMessageFlags &= ~LH_MSG_FLAG_MSGPACK;
+    }
+}
+
+/**
+ * @brief Get the format of the payload carried by the frame
+ *
+ * @return uint8_t LH_PAYLOAD_FORMAT_JSON or LH_PAYLOAD_FORMAT_MSGPACK
+ */
+uint8_t LoRaHomeFrame::getPayloadFormat() const
+{
+    return (mMessageFlags & LH_MSG_FLAG_MSGPACK) ? LH_PAYLOAD_FORMAT_MSGPACK : LH_PAYLOAD_FORMAT_JSON;
+}
+
+/**
+ * @brief Decode the payload according to its format
+ *
+ * @param payload the document to fill
+ * @return DeserializationError
+ */
+DeserializationError LoRaHomeFrame::deserializePayload(JsonDocument& payload) const
+{
+    if (LH_PAYLOAD_FORMAT_MSGPACK == getPayloadFormat())
+    {
+        return deserializeMsgPack(payload, mPayload, mPayloadSize);
+    }
+    return deserializeJson(payload, mPayload, mPayloadSize);
 }
 
 /**
@@ -91,25 +134,69 @@ uint8_t LoRaHomeFrame::serialize(uint8_t* txBuffer)
     DEBUG_MSG("LoRaHomeFrame::serialize");
     txBuffer[LH_FRAME_INDEX_EMITTER] = this->mNodeIdEmitter;
     txBuffer[LH_FRAME_INDEX_RECIPIENT] = this->mNodeIdRecipient;
-    txBuffer[LH_FRAME_INDEX_MESSAGE_TYPE] = this->mMessageType;
+    txBuffer[LH_FRAME_INDEX_MESSAGE_TYPE] = this->mMessageType | this->mMessageFlags;
     txBuffer[LH_FRAME_INDEX_NETWORK_ID] = (uint8_t)(this->mNetworkID & 0xff);
     txBuffer[LH_FRAME_INDEX_NETWORK_ID + 1] = (uint8_t)((this->mNetworkID >> 8)) & 0xff;
     txBuffer[LH_FRAME_INDEX_COUNTER] = (uint8_t)(this->mCounter & 0xff);
     txBuffer[LH_FRAME_INDEX_COUNTER + 1] = (uint8_t)((this->mCounter >> 8)) & 0xff;
-    uint8_t payloadSize = strlen(this->mJsonPayload);
+    uint8_t payloadSize = this->mPayloadSize;
     txBuffer[LH_FRAME_INDEX_PAYLOAD_SIZE] = payloadSize;
     if (payloadSize > 0)
     {
-        memcpy((char*)&txBuffer[LH_FRAME_INDEX_PAYLOAD], this->mJsonPayload, payloadSize);
+        memcpy((char*)&txBuffer[LH_FRAME_INDEX_PAYLOAD], this->mPayload, payloadSize);
     }
-    this->mCrc16 = crc16_ccitt(txBuffer, LH_FRAME_HEADER_SIZE + payloadSize);
+    this->mCrc16 = LoRaHomeCrc16::compute(txBuffer, LH_FRAME_HEADER_SIZE + payloadSize);
     txBuffer[LH_FRAME_HEADER_SIZE + payloadSize + LH_FRAME_FOOTER_SIZE - 2] = this->mCrc16 & 0xff;
     txBuffer[LH_FRAME_HEADER_SIZE + payloadSize + LH_FRAME_FOOTER_SIZE - 1] = (this->mCrc16 >> 8) & 0xff;
     return LH_FRAME_HEADER_SIZE + payloadSize + LH_FRAME_FOOTER_SIZE;
 }
 
+/**
+ * @brief serialize a frame without payload, e.g. an ack, without building a LoRaHomeFrame and its payload buffer
+ *
+ * @param txBuffer at least LH_FRAME_ACK_SIZE bytes
+ * @param messageType type and flags
+ * @return uint8_t LH_FRAME_ACK_SIZE
+ */
+uint8_t LoRaHomeFrame::serializeAck(uint8_t* txBuffer, uint16_t networkID, uint8_t nodeIdEmitter, uint8_t nodeIdRecipient, uint8_t messageType, uint16_t counter)
+{
+    txBuffer[LH_FRAME_INDEX_EMITTER] = nodeIdEmitter;
+    txBuffer[LH_FRAME_INDEX_RECIPIENT] = nodeIdRecipient;
+    txBuffer[LH_FRAME_INDEX_MESSAGE_TYPE] = messageType;
+    txBuffer[LH_FRAME_INDEX_NETWORK_ID] = (uint8_t)(networkID & 0xff);
+    txBuffer[LH_FRAME_INDEX_NETWORK_ID + 1] = (uint8_t)((networkID >> 8)) & 0xff;
+    txBuffer[LH_FRAME_INDEX_COUNTER] = (uint8_t)(counter & 0xff);
+    txBuffer[LH_FRAME_INDEX_COUNTER + 1] = (uint8_t)((counter >> 8)) & 0xff;
+    txBuffer[LH_FRAME_INDEX_PAYLOAD_SIZE] = 0;
+    uint16_t crc16 = LoRaHomeCrc16::compute(txBuffer, LH_FRAME_HEADER_SIZE);
+    txBuffer[LH_FRAME_HEADER_SIZE] = crc16 & 0xff;
+    txBuffer[LH_FRAME_HEADER_SIZE + 1] = (crc16 >> 8) & 0xff;
+    return LH_FRAME_ACK_SIZE;
+}
+
+/**
+ * @brief serialize a selective ack: every counter up to counter is acked, plus counter + 1 + i for each bit i of bitmap
+ *
+ * @param txBuffer at least LH_FRAME_SACK_SIZE bytes
+ * @param flags capabilities of the emitter
+ * @param counter cumulative ack
+ * @param bitmap counters received after the cumulative ack
+ * @return uint8_t LH_FRAME_SACK_SIZE
+ */
+uint8_t LoRaHomeFrame::serializeSelectiveAck(uint8_t* txBuffer, uint16_t networkID, uint8_t nodeIdEmitter, uint8_t nodeIdRecipient, uint8_t flags, uint16_t counter, uint8_t bitmap)
+{
+    serializeAck(txBuffer, networkID, nodeIdEmitter, nodeIdRecipient, LH_MSG_TYPE_GW_SACK | (flags & LH_MSG_FLAGS_MASK), counter);
+    txBuffer[LH_FRAME_INDEX_PAYLOAD_SIZE] = 1;
+    txBuffer[LH_FRAME_INDEX_PAYLOAD] = bitmap;
+    uint16_t crc16 = LoRaHomeCrc16::compute(txBuffer, LH_FRAME_HEADER_SIZE + 1);
+    txBuffer[LH_FRAME_HEADER_SIZE + 1] = crc16 & 0xff;
+    txBuffer[LH_FRAME_HEADER_SIZE + 2] = (crc16 >> 8) & 0xff;
+    return LH_FRAME_SACK_SIZE;
+}
+
 /**
  * @brief Create a LoRaHomeFrame from a raw bytes message
+ * The payload is copied, use LoRaHomeFrameView to avoid the copy
  *
  * @param rawBytesWithCRC raw bytes message with CRC included
  * @param length length of the message (number of bytes)
@@ -121,31 +208,24 @@ uint8_t LoRaHomeFrame::serialize(uint8_t* txBuffer)
 bool LoRaHomeFrame::createFromRxMessage(uint8_t* rawBytesWithCRC, uint8_t length, bool checkCRC)
 {
     DEBUG_MSG("LoRaHomeFrame::createFromRxMessage");
-    if (checkCRC)
+    LoRaHomeFrameView view(rawBytesWithCRC, length);
+    if (!view.isValid(checkCRC))
     {
-        if (!this->checkCRC(rawBytesWithCRC, length))
-        {
-            return false;
-        }
-    }
-    // TODO should check whether data are valid or not?
-    this->mNetworkID = rawBytesWithCRC[LH_FRAME_INDEX_NETWORK_ID] | (rawBytesWithCRC[LH_FRAME_INDEX_NETWORK_ID + 1] << 8);
-    this->mNodeIdEmitter = rawBytesWithCRC[LH_FRAME_INDEX_EMITTER];
-    this->mNodeIdRecipient = rawBytesWithCRC[LH_FRAME_INDEX_RECIPIENT];
-    this->mMessageType = rawBytesWithCRC[LH_FRAME_INDEX_MESSAGE_TYPE];
-    this->mCounter = rawBytesWithCRC[LH_FRAME_INDEX_COUNTER] | (rawBytesWithCRC[LH_FRAME_INDEX_COUNTER + 1] << 8);
-    this->mPayloadSize = rawBytesWithCRC[LH_FRAME_INDEX_PAYLOAD_SIZE];
-    if (this->mPayloadSize > LH_FRAME_MAX_PAYLOAD_SIZE)
-    {
-        DEBUG_MSG("--- invalid payload size");
         return false;
     }
-    // copy the json payload if any
+    this->mNetworkID = view.getNetworkID();
+    this->mNodeIdEmitter = view.getNodeIdEmitter();
+    this->mNodeIdRecipient = view.getNodeIdRecipient();
+    this->mMessageType = view.getMessageType();
+    this->mMessageFlags = view.getMessageFlags();
+    this->mCounter = view.getCounter();
+    this->mPayloadSize = view.getPayloadSize();
+    // copy the payload if any
     if (this->mPayloadSize != 0)
     {
-        memcpy(this->mJsonPayload, &rawBytesWithCRC[LH_FRAME_INDEX_PAYLOAD], rawBytesWithCRC[LH_FRAME_INDEX_PAYLOAD_SIZE]);
-        this->mJsonPayload[this->mPayloadSize] = '\0';
+        memcpy(this->mPayload, view.getPayload(), this->mPayloadSize);
     }
+    this->mPayload[this->mPayloadSize] = '\0';
     return true;
 }
 
@@ -176,7 +256,7 @@ bool LoRaHomeFrame::checkCRC(uint8_t* rawBytesWithCRC, uint8_t length)
     uint8_t highCRC = rawBytesWithCRC[length - 1];
     uint16_t rx_crc16 = lowCRC | (highCRC << 8);
     // compute CRC16 without the last 2 bytes
-    uint16_t crc16 = crc16_ccitt(rawBytesWithCRC, length - 2);
+    uint16_t crc16 = LoRaHomeCrc16::compute(rawBytesWithCRC, length - 2);
     // if CRC16 not valid, ignore LoRa message
     if (rx_crc16 != crc16)
     {
@@ -187,36 +267,6 @@ bool LoRaHomeFrame::checkCRC(uint8_t* rawBytesWithCRC, uint8_t length)
     return true;
 }
 
-/**
- * @brief compute CRC16 ccitt
- *
- * @param data data to be used to compute CRC16
- * @param data_len length of the buffer
- * @return uint16_t
- */
-uint16_t LoRaHomeFrame::crc16_ccitt(uint8_t* data, unsigned int data_len)
-{
-    uint16_t crc = 0xFFFF;
-
-    if (data_len == 0)
-        return 0;
-
-    for (unsigned int i = 0; i < data_len; ++i)
-    {
-        uint16_t dbyte = data[i];
-        crc ^= dbyte << 8;
-
-        for (unsigned char j = 0; j < 8; ++j)
-        {
-            uint16_t mix = crc & 0x8000;
-            crc = (crc << 1);
-            if (mix)
-                crc = crc ^ 0x1021;
-        }
-    }
-    return crc;
-}
-
 void LoRaHomeFrame::print()
 {
     DEBUG_MSG("LoRaHomeFrame::print");
@@ -228,8 +278,17 @@ void LoRaHomeFrame::print()
     DEBUG_MSG_VAR(this->mNodeIdRecipient);
     DEBUG_MSG_ONELINE("MessageType: ");
     DEBUG_MSG_VAR(this->mMessageType);
+    DEBUG_MSG_ONELINE("MessageFlags: ");
+    DEBUG_MSG_VAR(this->mMessageFlags);
     DEBUG_MSG_ONELINE("Counter: ");
     DEBUG_MSG_VAR(this->mCounter);
     DEBUG_MSG_ONELINE("Payload: ");
-    DEBUG_MSG_VAR(this->mJsonPayload);
+    if (LH_PAYLOAD_FORMAT_JSON == getPayloadFormat())
+    {
+        DEBUG_MSG_VAR(this->mPayload);
+    }
+    else
+    {
+        DEBUG_MSG_VAR(this->mPayloadSize);
+    }
 }
\ No newline at end of file
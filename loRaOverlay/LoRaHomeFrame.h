@@ -1,7 +1,13 @@
 #ifndef LORAHOMEFRAME_H
 #define LORAHOMEFRAME_H
 
+// Arduino free on a host, e.g. for LoRaHomeGateway
+#ifdef ARDUINO
 #include <Arduino.h>
+#else
+#include <stdint.h>
+#include <string.h>
+#endif
 #include <ArduinoJson.h>
 
 const uint8_t LH_FRAME_HEADER_SIZE = 8;
@@ -9,6 +15,7 @@ const uint8_t LH_FRAME_FOOTER_SIZE = 2; // only CRC for now. TODO: add security
 const uint8_t LH_FRAME_MAX_PAYLOAD_SIZE = 128;
 const uint8_t LH_FRAME_MIN_SIZE = LH_FRAME_HEADER_SIZE + LH_FRAME_FOOTER_SIZE;
 const uint8_t LH_FRAME_ACK_SIZE = LH_FRAME_HEADER_SIZE + LH_FRAME_FOOTER_SIZE;
+const uint8_t LH_FRAME_SACK_SIZE = LH_FRAME_ACK_SIZE + 1;
 const uint8_t LH_FRAME_MAX_SIZE = LH_FRAME_HEADER_SIZE + LH_FRAME_FOOTER_SIZE + LH_FRAME_MAX_PAYLOAD_SIZE;
 
 const uint8_t LH_FRAME_INDEX_EMITTER = 0;
@@ -31,6 +38,27 @@ const uint8_t LH_MSG_TYPE_GW_MSG_ACK = 0x03;
 
 const uint8_t LH_MSG_TYPE_NODE_ACK = 0x04;
 const uint8_t LH_MSG_TYPE_GW_ACK = 0x06;
+// Selective ack: counter is the cumulative ack, 1 byte payload is the bitmap of the next received counters
+const uint8_t LH_MSG_TYPE_GW_SACK = 0x07;
+
+// The low nibble of the message type byte holds the type, the high nibble holds flags.
+// On a frame carrying a payload, a flag describes the payload.
+// On an ack frame, flags advertise the capabilities of the emitter.
+const uint8_t LH_MSG_TYPE_MASK = 0x0F;
+const uint8_t LH_MSG_FLAGS_MASK = 0xF0;
+const uint8_t LH_MSG_FLAG_MSGPACK = 0x80;
+// only meaningful as a capability: several frames can be in flight, acked with LH_MSG_TYPE_GW_SACK
+const uint8_t LH_MSG_FLAG_SACK = 0x40;
+// only on a frame of a node: the next frame of its Tx window follows at once.
+// Radios are half duplex, the gateway defers its selective ack until the last frame of the burst.
+const uint8_t LH_MSG_FLAG_MORE = 0x20;
+// only meaningful as a capability of the gateway: it receives every spreading factor,
+// the nodes can change theirs (ADR). Without it, the ADR of a node only tunes its Tx power.
+const uint8_t LH_MSG_FLAG_ADR = 0x10;
+
+// Payload Format
+const uint8_t LH_PAYLOAD_FORMAT_JSON = 0x00;
+const uint8_t LH_PAYLOAD_FORMAT_MSGPACK = 0x01;
 
 class LoRaHomeFrame
 {
@@ -41,12 +69,17 @@ public:
 
     void setCounter(uint16_t counter);
     uint16_t getCounter() const { return mCounter; }
-    void setPayload(const JsonDocument& payload);
-    const char* getPayload() const { return mJsonPayload; }
+    void setPayload(const JsonDocument& payload, uint8_t format = LH_PAYLOAD_FORMAT_JSON);
+    const char* getPayload() const { return mPayload; }
+    uint8_t getPayloadSize() const { return mPayloadSize; }
+    uint8_t getPayloadFormat() const;
+    DeserializationError deserializePayload(JsonDocument& payload) const;
 
     void clear();
 
     uint8_t serialize(uint8_t *txBuffer);
+    static uint8_t serializeAck(uint8_t *txBuffer, uint16_t networkID, uint8_t nodeIdEmitter, uint8_t nodeIdRecipient, uint8_t messageType, uint16_t counter);
+    static uint8_t serializeSelectiveAck(uint8_t *txBuffer, uint16_t networkID, uint8_t nodeIdEmitter, uint8_t nodeIdRecipient, uint8_t flags, uint16_t counter, uint8_t bitmap);
     bool createFromRxMessage(uint8_t *rawBytesWithCRC, uint8_t length, bool checkCRC);
 
     uint8_t getNodeIdEmitter() const { return mNodeIdEmitter; }
@@ -54,24 +87,25 @@ public:
     void setNodeIdRecipient(uint8_t nodeIdRecipient) { mNodeIdRecipient = nodeIdRecipient; }
     inline uint8_t getNodeIdRecipient() { return mNodeIdRecipient; };
     uint8_t getMessageType() const { return mMessageType; }
+    void setMessageFlags(uint8_t messageFlags) { mMessageFlags = messageFlags & LH_MSG_FLAGS_MASK; }
+    uint8_t getMessageFlags() const { return mMessageFlags; }
 
     bool checkCRC(uint8_t *rawBytesWithCRC, uint8_t length);
 
     void print();
-    
-private:
-    uint16_t crc16_ccitt(uint8_t *data, unsigned int data_len);
 
 protected:
     uint16_t mNetworkID;
     uint8_t mNodeIdEmitter;
     uint8_t mNodeIdRecipient;
     uint8_t mMessageType;
+    uint8_t mMessageFlags;
     uint16_t mCounter;
     uint8_t mPayloadSize;
     uint8_t mAes_IV;
     uint16_t mCrc16;
-    char mJsonPayload[LH_FRAME_MAX_PAYLOAD_SIZE];
+    // JSON payload is null terminated, MessagePack payload relies on mPayloadSize
+    char mPayload[LH_FRAME_MAX_PAYLOAD_SIZE + 1];
 };
 
 #endif
\ No newline at end of file
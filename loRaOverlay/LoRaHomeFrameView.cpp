@@ -0,0 +1,120 @@
+#include "LoRaHomeFrameView.h"
+#include "LoRaHomeCrc.h"
+
+// #define DEBUG
+
+#ifdef DEBUG
+#define DEBUG_MSG(x) Serial.println(F(x))
+#else
+#define DEBUG_MSG(x) // define empty, so macro does nothing
+#endif
+
+/**
+ * @brief Construct a new LoRaHomeFrameView over a received message, nothing is copied
+ *
+ * @param rawBytesWithCRC raw bytes message with CRC included
+ * @param length length of the message (number of bytes)
+ */
+LoRaHomeFrameView::LoRaHomeFrameView(uint8_t *rawBytesWithCRC, uint8_t length):
+    mRawBytes(rawBytesWithCRC),
+    mLength(length)
+{
+}
+
+/**
+ * @brief Check the frame length, the payload size and optionally the CRC.
+ * Header accessors shall only be used on a valid frame.
+ *
+ * @param checkCRC indicate whether the CRC should be checked or not
+ * @return true
+ * @return false
+ */
+bool LoRaHomeFrameView::isValid(bool checkCRC) const
+{
+    if (mLength < LH_FRAME_MIN_SIZE)
+    {
+        DEBUG_MSG("--- bad packet received too small");
+        return false;
+    }
+    if (mLength > LH_FRAME_MAX_SIZE)
+    {
+        DEBUG_MSG("--- bad packet received too big");
+        return false;
+    }
+    if ((getPayloadSize() > LH_FRAME_MAX_PAYLOAD_SIZE)
+        || (LH_FRAME_HEADER_SIZE + getPayloadSize() + LH_FRAME_FOOTER_SIZE != mLength))
+    {
+        DEBUG_MSG("--- invalid payload size");
+        return false;
+    }
+    if (checkCRC)
+    {
+        // last 2 bytes contain CRC16 of the rest of the frame
+        uint16_t rx_crc16 = mRawBytes[mLength - 2] | (mRawBytes[mLength - 1] << 8);
+        if (rx_crc16 != LoRaHomeCrc16::compute(mRawBytes, mLength - 2))
+        {
+            DEBUG_MSG("--- CRC Error");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Get the format of the payload carried by the frame
+ *
+ * @return uint8_t LH_PAYLOAD_FORMAT_JSON or LH_PAYLOAD_FORMAT_MSGPACK
+ */
+uint8_t LoRaHomeFrameView::getPayloadFormat() const
+{
+    return (getMessageFlags() & LH_MSG_FLAG_MSGPACK) ? LH_PAYLOAD_FORMAT_MSGPACK : LH_PAYLOAD_FORMAT_JSON;
+}
+
+/**
+ * @brief Decode the payload directly from the raw buffer according to its format
+ *
+ * @param payload the document to fill
+ * @return DeserializationError
+ */
+DeserializationError LoRaHomeFrameView::deserializePayload(JsonDocument &payload) const
+{
+    // mutable input: ArduinoJson is allowed to work in place
+    char *rawPayload = reinterpret_cast<char *>(getPayload());
+    if (LH_PAYLOAD_FORMAT_MSGPACK == getPayloadFormat())
+    {
+        return deserializeMsgPack(payload, rawPayload, getPayloadSize());
+    }
+    return deserializeJson(payload, rawPayload, getPayloadSize());
+}
+
+/**
+ * @brief Overwrite the counter of the frame in place. updateCRC shall be called afterwards.
+ *
+ * @param counter
+ */
+void LoRaHomeFrameView::setCounter(uint16_t counter)
+{
+    mRawBytes[LH_FRAME_INDEX_COUNTER] = (uint8_t)(counter & 0xff);
+    mRawBytes[LH_FRAME_INDEX_COUNTER + 1] = (uint8_t)((counter >> 8) & 0xff);
+}
+
+/**
+ * @brief Overwrite the flags of the message type in place, the type is kept. updateCRC shall be called afterwards.
+ *
+ * @param flags LH_MSG_FLAG_xxx
+ */
+void LoRaHomeFrameView::setMessageFlags(uint8_t flags)
+{
+    mRawBytes[LH_FRAME_INDEX_MESSAGE_TYPE] = (mRawBytes[LH_FRAME_INDEX_MESSAGE_TYPE] & LH_MSG_TYPE_MASK) | (flags & LH_MSG_FLAGS_MASK);
+}
+
+/**
+ * @brief Recompute the CRC in place after the frame has been modified
+ *
+ */
+void LoRaHomeFrameView::updateCRC()
+{
+    uint16_t crc16 = LoRaHomeCrc16::compute(mRawBytes, mLength - LH_FRAME_FOOTER_SIZE);
+    mRawBytes[mLength - 2] = crc16 & 0xff;
+    mRawBytes[mLength - 1] = (crc16 >> 8) & 0xff;
+}
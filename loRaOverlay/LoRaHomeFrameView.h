@@ -0,0 +1,44 @@
+#ifndef LORAHOMEFRAMEVIEW_H
+#define LORAHOMEFRAMEVIEW_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
+#include <ArduinoJson.h>
+#include <loRaOverlay/LoRaHomeFrame.h>
+
+// Non owning view of a raw LoRaHomeFrame, header fields are read in place.
+// The buffer shall outlive the view and any JsonDocument deserialized from it.
+class LoRaHomeFrameView
+{
+public:
+    LoRaHomeFrameView(uint8_t *rawBytesWithCRC, uint8_t length);
+    virtual ~LoRaHomeFrameView() = default;
+
+    bool isValid(bool checkCRC) const;
+
+    uint8_t getNodeIdEmitter() const { return mRawBytes[LH_FRAME_INDEX_EMITTER]; }
+    uint8_t getNodeIdRecipient() const { return mRawBytes[LH_FRAME_INDEX_RECIPIENT]; }
+    uint8_t getMessageType() const { return mRawBytes[LH_FRAME_INDEX_MESSAGE_TYPE] & LH_MSG_TYPE_MASK; }
+    uint8_t getMessageFlags() const { return mRawBytes[LH_FRAME_INDEX_MESSAGE_TYPE] & LH_MSG_FLAGS_MASK; }
+    uint16_t getNetworkID() const { return mRawBytes[LH_FRAME_INDEX_NETWORK_ID] | (mRawBytes[LH_FRAME_INDEX_NETWORK_ID + 1] << 8); }
+    uint16_t getCounter() const { return mRawBytes[LH_FRAME_INDEX_COUNTER] | (mRawBytes[LH_FRAME_INDEX_COUNTER + 1] << 8); }
+    uint8_t getPayloadSize() const { return mRawBytes[LH_FRAME_INDEX_PAYLOAD_SIZE]; }
+    uint8_t *getPayload() const { return &mRawBytes[LH_FRAME_INDEX_PAYLOAD]; }
+    uint8_t getPayloadFormat() const;
+    uint8_t getLength() const { return mLength; }
+
+    DeserializationError deserializePayload(JsonDocument &payload) const;
+
+    void setCounter(uint16_t counter);
+    void setMessageFlags(uint8_t flags);
+    void updateCRC();
+
+private:
+    uint8_t *mRawBytes;
+    uint8_t mLength;
+};
+
+#endif
@@ -0,0 +1,438 @@
+#include "LoRaHomeGateway.h"
+
+/**
+ * @brief Construct a new LoRaHomeGateway, without any node known
+ *
+ * @param radio the radio backend
+ * @param networkID frames of other networks are ignored
+ * @param capabilities LH_MSG_FLAG_xxx advertised to the nodes in the acks, LH_MSG_FLAG_ADR needs a multi spreading factor radio
+ */
+LoRaHomeGateway::LoRaHomeGateway(LoRaHomeRadio& radio, uint16_t networkID, uint8_t capabilities):
+    mRadio(radio),
+    mListener(nullptr),
+    mNetworkID(networkID),
+    mCapabilities(capabilities & LH_MSG_FLAGS_MASK),
+    mDownlinkFrame(networkID, LH_NODE_ID_GATEWAY, LH_NODE_ID_BROADCAST, LH_MSG_TYPE_GW_MSG_ACK),
+    mRxCount(0),
+    mInvalidCount(0),
+    mAckCount(0),
+    mSackPendingCount(0)
+{
+    if (!radio.isMultiSpreadingFactor())
+    {
+        mCapabilities &= ~LH_MSG_FLAG_ADR;
+    }
+    memset(mNodes, 0, sizeof(mNodes));
+    for (uint16_t i = 0; i < LH_GATEWAY_NODE_COUNT; i++)
+    {
+        mNodes[i].downlink = LH_GATEWAY_NO_DOWNLINK;
+    }
+    for (uint8_t i = 0; i < LH_GATEWAY_DOWNLINK_POOL_SIZE; i++)
+    {
+        mDownlinkSizes[i] = 0;
+    }
+}
+
+/**
+ * @brief Handle the frames received by the radio, to be called at each main loop
+ *
+ * @param now current time in ms
+ * @param maxFrames max number of frames handled by this call, to bound the loop duration
+ * @return uint16_t number of frames handled
+ */
+uint16_t LoRaHomeGateway::process(unsigned long now, uint16_t maxFrames)
+{
+    uint16_t count(0);
+    while (count < maxFrames)
+    {
+        int16_t snr(0);
+        int16_t rssi(0);
+        uint8_t length = mRadio.receive(mRxBuffer, LH_FRAME_MAX_SIZE, snr, rssi);
+        if (0 == length)
+        {
+            break;
+        }
+        handleFrame(mRxBuffer, length, snr, rssi, now);
+        count++;
+    }
+    sendPendingSelectiveAcks(now);
+    return count;
+}
+
+/**
+ * @brief Handle a raw frame: ack, node state update, delivery to the listener, then pending downlink.
+ * A duplicate (retransmission after a lost ack) is acked again but not delivered again.
+ * The selective ack of a frame followed by another one of the same burst is deferred, as the pending downlink.
+ *
+ * @param rawBytesWithCRC raw frame, decoded in place
+ * @param length size of the frame
+ * @param snr SNR of the frame in tenths of dB
+ * @param rssi RSSI of the frame in dBm
+ * @param now current time in ms
+ * @return true if the frame is a message for the gateway
+ */
+bool LoRaHomeGateway::handleFrame(uint8_t* rawBytesWithCRC, uint8_t length, int16_t snr, int16_t rssi, unsigned long now)
+{
+    LoRaHomeFrameView frame(rawBytesWithCRC, length);
+    if (!frame.isValid(true))
+    {
+        mInvalidCount++;
+        return false;
+    }
+    uint8_t nodeId = frame.getNodeIdEmitter();
+    if ((frame.getNetworkID() != mNetworkID)
+        || (LH_NODE_ID_GATEWAY != frame.getNodeIdRecipient())
+        || (LH_NODE_ID_GATEWAY == nodeId)
+        || (LH_NODE_ID_BROADCAST == nodeId))
+    {
+        return false;
+    }
+
+    LoRaHomeGatewayNode& node = mNodes[nodeId];
+    // the node may have changed its spreading factor (ADR), it listens on the one of its last frame
+    uint8_t spreadingFactor = mRadio.getRxSpreadingFactor();
+    if (0 != spreadingFactor)
+    {
+        node.spreadingFactor = spreadingFactor;
+    }
+    switch (frame.getMessageType())
+    {
+    case LH_MSG_TYPE_NODE_ACK:
+        handleDownlinkAck(node, frame.getCounter(), now);
+        return false;
+    case LH_MSG_TYPE_NODE_MSG_ACK_REQ:
+        if (mCapabilities & node.capabilities & LH_MSG_FLAG_SACK)
+        {
+            if (frame.getMessageFlags() & LH_MSG_FLAG_MORE)
+            {
+                if (!node.isSackPending)
+                {
+                    node.isSackPending = true;
+                    mSackPendingCount++;
+                }
+                node.sackTime = now;
+            }
+            else
+            {
+                // acked before delivery, the window is only recorded once delivered
+                LoRaHomeDedupeWindow rxWindow = node.rxWindow;
+                rxWindow.record(frame.getCounter(), now);
+                sendSelectiveAck(nodeId, rxWindow);
+            }
+        }
+        else
+        {
+            sendAck(nodeId, frame.getCounter());
+        }
+        break;
+    case LH_MSG_TYPE_NODE_MSG_NO_ACK_REQ:
+        break;
+    default:
+        return false;
+    }
+
+    if (node.rxWindow.isDuplicate(frame.getCounter(), now))
+    {
+        node.duplicateCount++;
+        if (!node.isSackPending)
+        {
+            sendDownlink(nodeId, now);
+        }
+        return false;
+    }
+    mRxCount++;
+    updateNode(node, frame.getCounter(), snr, rssi, now);
+    if (nullptr != mListener)
+    {
+        mListener->onNodeMessage(nodeId, frame);
+    }
+    // recorded once delivered: a frame is acked on its CRC, its payload is decoded by the listener
+    node.rxWindow.record(frame.getCounter(), now);
+    if (!node.isSackPending)
+    {
+        sendDownlink(nodeId, now);
+    }
+    return true;
+}
+
+/**
+ * @brief Decode the payload of a message, and track the protocol keys sent by the node
+ * (capabilities and Tx power). The values of a telemetry frame are rebuilt from the last keyframe of the node,
+ * deltas to another keyframe are removed.
+ *
+ * @param frame the message received
+ * @param payload the document to fill
+ * @return DeserializationError
+ */
+DeserializationError LoRaHomeGateway::decodePayload(const LoRaHomeFrameView& frame, JsonDocument& payload)
+{
+    DeserializationError error = frame.deserializePayload(payload);
+    if (error)
+    {
+        return error;
+    }
+    uint8_t nodeId = frame.getNodeIdEmitter();
+    LoRaHomeGatewayNode& node = mNodes[nodeId];
+    if (payload[MSG_CAPABILITIES].is<uint8_t>())
+    {
+        node.capabilities = payload[MSG_CAPABILITIES].as<uint8_t>() & LH_MSG_FLAGS_MASK;
+    }
+    if (payload[MSG_TX_POWER].is<int8_t>())
+    {
+        node.txPower = payload[MSG_TX_POWER].as<int8_t>();
+    }
+    if (LoRaHomeTelemetryDecoder::isTelemetry(payload))
+    {
+        mTelemetryDecoders[nodeId].decode(payload);
+    }
+    return error;
+}
+
+/**
+ * @brief Extract one reading of a batch received from a node (LoRaHomeBatch), to be called
+ * from index 0 until it returns false
+ *
+ * @param nodeId emitter of the batch
+ * @param payload payload decoded by decodePayload
+ * @param index of the reading, from the oldest one
+ * @param reading filled with the reading
+ * @param time filled with the time of the reading on the clock of the gateway, in ms
+ * @return true if the reading is extracted
+ * @return false if index is out of range, or the payload is not a batch
+ */
+bool LoRaHomeGateway::unpackReading(uint8_t nodeId, const JsonDocument& payload, uint8_t index, JsonDocument& reading,
+                                    unsigned long& time) const
+{
+    unsigned long age(0);
+    if (!LoRaHomeBatchDecoder::unpack(payload, index, reading, age))
+    {
+        return false;
+    }
+    // the age is counted when the batch is built, the transmission delay is not accounted
+    time = mNodes[nodeId].lastRxTime - age;
+    return true;
+}
+
+/**
+ * @brief Queue a message for a node, sent after its next uplink
+ * A downlink already pending for the node is replaced.
+ *
+ * @param nodeId recipient
+ * @param payload JSON payload, MessagePack encoded if the node advertised it
+ * @return true if queued
+ * @return false if the downlink pool is full
+ */
+bool LoRaHomeGateway::queueDownlink(uint8_t nodeId, const JsonDocument& payload)
+{
+    if ((LH_NODE_ID_GATEWAY == nodeId) || (LH_NODE_ID_BROADCAST == nodeId))
+    {
+        return false;
+    }
+    LoRaHomeGatewayNode& node = mNodes[nodeId];
+    if (LH_GATEWAY_NO_DOWNLINK == node.downlink)
+    {
+        node.downlink = allocateDownlink();
+        if (LH_GATEWAY_NO_DOWNLINK == node.downlink)
+        {
+            return false;
+        }
+    }
+    uint8_t format = (mCapabilities & node.capabilities & LH_MSG_FLAG_MSGPACK) ? LH_PAYLOAD_FORMAT_MSGPACK : LH_PAYLOAD_FORMAT_JSON;
+    node.downlinkCounter++;
+    node.downlinkRetries = 0;
+    mDownlinkFrame.setNodeIdRecipient(nodeId);
+    mDownlinkFrame.setCounter(node.downlinkCounter);
+    mDownlinkFrame.setPayload(payload, format);
+    mDownlinkSizes[node.downlink] = mDownlinkFrame.serialize(mDownlinks[node.downlink]);
+    return true;
+}
+
+/**
+ * @brief Send the ack of a message, the capabilities of the gateway are advertised in its flags
+ *
+ * @param nodeId recipient
+ * @param counter counter of the message acked
+ */
+void LoRaHomeGateway::sendAck(uint8_t nodeId, uint16_t counter)
+{
+    uint8_t size = LoRaHomeFrame::serializeAck(mTxBuffer, mNetworkID, LH_NODE_ID_GATEWAY, nodeId,
+                                               LH_MSG_TYPE_GW_ACK | mCapabilities, counter);
+    mRadio.setTxSpreadingFactor(getSpreadingFactor(mNodes[nodeId]));
+    if (mRadio.send(mTxBuffer, size))
+    {
+        mAckCount++;
+    }
+}
+
+/**
+ * @brief Send the selective ack of the counters received from a node, a deferred one is no longer pending
+ *
+ * @param nodeId recipient
+ * @param rxWindow counters received from the node
+ */
+void LoRaHomeGateway::sendSelectiveAck(uint8_t nodeId, const LoRaHomeDedupeWindow& rxWindow)
+{
+    LoRaHomeGatewayNode& node = mNodes[nodeId];
+    if (node.isSackPending)
+    {
+        node.isSackPending = false;
+        mSackPendingCount--;
+    }
+    uint8_t bitmap(0);
+    uint16_t counter = rxWindow.getSelectiveAck(bitmap);
+    uint8_t size = LoRaHomeFrame::serializeSelectiveAck(mTxBuffer, mNetworkID, LH_NODE_ID_GATEWAY, nodeId,
+                                                        mCapabilities, counter, bitmap);
+    mRadio.setTxSpreadingFactor(getSpreadingFactor(node));
+    if (mRadio.send(mTxBuffer, size))
+    {
+        mAckCount++;
+    }
+}
+
+/**
+ * @brief Send the deferred selective acks whose burst is over: the next frame announced is lost or delayed
+ *
+ * @param now current time in ms
+ */
+void LoRaHomeGateway::sendPendingSelectiveAcks(unsigned long now)
+{
+    for (uint16_t i = 0; (0 < mSackPendingCount) && (i < LH_GATEWAY_NODE_COUNT); i++)
+    {
+        LoRaHomeGatewayNode& node = mNodes[i];
+        if (node.isSackPending && (now - node.sackTime >= getSelectiveAckDelay(node)))
+        {
+            sendSelectiveAck(i, node.rxWindow);
+            sendDownlink(i, now);
+        }
+    }
+}
+
+/**
+ * @brief Get how long a selective ack is deferred: the airtime of the next frame announced, plus a margin
+ *
+ * @param node emitter of the burst
+ * @return unsigned long delay in ms after the last frame received
+ */
+unsigned long LoRaHomeGateway::getSelectiveAckDelay(const LoRaHomeGatewayNode& node) const
+{
+    return LoRaHomeAirtime::getTimeOnAirMs(getSpreadingFactor(node), LORA_SIGNAL_BANDWIDTH, LORA_CODING_RATE_DENOMINATOR,
+                                           true, LORA_PREAMBLE_LENGTH, LH_FRAME_MAX_SIZE)
+           + LH_GATEWAY_SACK_MARGIN;
+}
+
+/**
+ * @brief Get the spreading factor a node transmits and listens on
+ *
+ * @param node the node
+ * @return uint8_t the one of its last uplink, LORA_SPREADING_FACTOR if unknown
+ */
+uint8_t LoRaHomeGateway::getSpreadingFactor(const LoRaHomeGatewayNode& node) const
+{
+    return (0 != node.spreadingFactor) ? node.spreadingFactor : LORA_SPREADING_FACTOR;
+}
+
+/**
+ * @brief Send the pending downlink of a node, or give it up once max retry is reached
+ *
+ * @param nodeId recipient
+ * @param now current time in ms
+ */
+void LoRaHomeGateway::sendDownlink(uint8_t nodeId, unsigned long now)
+{
+    LoRaHomeGatewayNode& node = mNodes[nodeId];
+    if (LH_GATEWAY_NO_DOWNLINK == node.downlink)
+    {
+        return;
+    }
+    if (MAX_RETRY_NO_VALID_ACK <= node.downlinkRetries)
+    {
+        mDownlinkSizes[node.downlink] = 0;
+        node.downlink = LH_GATEWAY_NO_DOWNLINK;
+        return;
+    }
+    mRadio.setTxSpreadingFactor(getSpreadingFactor(node));
+    if (mRadio.send(mDownlinks[node.downlink], mDownlinkSizes[node.downlink]))
+    {
+        node.downlinkRetries++;
+        node.downlinkSentTime = now;
+    }
+}
+
+/**
+ * @brief Release the pending downlink acked by the node, and measure the round trip time
+ *
+ * @param node emitter of the ack
+ * @param counter counter acked
+ * @param now current time in ms
+ */
+void LoRaHomeGateway::handleDownlinkAck(LoRaHomeGatewayNode& node, uint16_t counter, unsigned long now)
+{
+    if ((LH_GATEWAY_NO_DOWNLINK == node.downlink) || (counter != node.downlinkCounter))
+    {
+        return;
+    }
+    // Karn's algorithm: only a downlink sent once gives a sample
+    if (1 == node.downlinkRetries)
+    {
+        unsigned long rtt = now - node.downlinkSentTime;
+        if (rtt > 0xFFFF)
+        {
+            rtt = 0xFFFF;
+        }
+        node.rtt = (0 == node.rtt) ? rtt : (uint16_t)(node.rtt + ((long)rtt - (long)node.rtt) / 8);
+    }
+    mDownlinkSizes[node.downlink] = 0;
+    node.downlink = LH_GATEWAY_NO_DOWNLINK;
+}
+
+/**
+ * @brief Update the state of a node with a message received
+ *
+ * @param node emitter of the message
+ * @param counter counter of the message
+ * @param snr SNR of the frame in tenths of dB
+ * @param rssi RSSI of the frame in dBm
+ * @param now current time in ms
+ */
+void LoRaHomeGateway::updateNode(LoRaHomeGatewayNode& node, uint16_t counter, int16_t snr, int16_t rssi, unsigned long now)
+{
+    if (0 == node.rxCount)
+    {
+        node.snr = snr;
+        node.rssi = rssi;
+    }
+    else
+    {
+        // wraparound safe gap, retransmissions give a null or negative gap.
+        // A node restarts from a random counter, a gap beyond the dedupe window is taken as a restart.
+        int16_t gap = (int16_t)(counter - node.lastCounter);
+        if ((gap > 1) && (gap <= LH_DEDUPE_WINDOW_SIZE))
+        {
+            node.lostCount += gap - 1;
+        }
+        node.snr += (snr - node.snr) / 8;
+        node.rssi += (rssi - node.rssi) / 8;
+    }
+    node.lastCounter = counter;
+    node.lastRxTime = now;
+    node.rxCount++;
+}
+
+/**
+ * @brief Find a free slot of the downlink pool
+ *
+ * @return uint8_t index of the slot, LH_GATEWAY_NO_DOWNLINK if the pool is full
+ */
+uint8_t LoRaHomeGateway::allocateDownlink()
+{
+    for (uint8_t i = 0; i < LH_GATEWAY_DOWNLINK_POOL_SIZE; i++)
+    {
+        if (0 == mDownlinkSizes[i])
+        {
+            // reserved until serialized
+            mDownlinkSizes[i] = LH_FRAME_MIN_SIZE;
+            return i;
+        }
+    }
+    return LH_GATEWAY_NO_DOWNLINK;
+}
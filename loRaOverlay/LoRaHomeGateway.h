@@ -0,0 +1,121 @@
+#ifndef LORAHOMEGATEWAY_H
+#define LORAHOMEGATEWAY_H
+
+#include <ArduinoJson.h>
+#include <loRaOverlay/LoRaHomeFrame.h>
+#include <loRaOverlay/LoRaHomeFrameView.h>
+#include <loRaOverlay/LoRaHomeRadio.h>
+#include <loRaOverlay/LoRaHomeDedupe.h>
+#include <loRaOverlay/LoRaHomeAirtime.h>
+#include <loRaOverlay/LoRaHomeTelemetryDecoder.h>
+#include <loRaOverlay/LoRaHomeBatchDecoder.h>
+#include <loRaOverlay/LoraConfig.h>
+
+const uint8_t LH_GATEWAY_NODE_COUNT = 0xFF; // every node ID but the broadcast one
+const uint8_t LH_GATEWAY_NO_DOWNLINK = 0xFF;
+
+// State of a node, kept by the gateway. Plain data, the table is a flat array indexed by node ID.
+struct LoRaHomeGatewayNode
+{
+    // time of the last frame received in ms, 0 if never
+    unsigned long lastRxTime;
+    uint32_t rxCount;
+    // retransmissions acked again but not delivered
+    uint32_t duplicateCount;
+    // frames missing between the received counters
+    uint32_t lostCount;
+    uint16_t lastCounter;
+    // smoothed link quality of the uplinks, SNR in tenths of dB, RSSI in dBm
+    int16_t snr;
+    int16_t rssi;
+    // LH_MSG_FLAG_xxx advertised by the node
+    uint8_t capabilities;
+    // spreading factor of the last uplink, given by the radio, 0 if unknown. Acks and downlinks are sent on it.
+    uint8_t spreadingFactor;
+    // Tx power announced by the node (ADR), 0 if unknown
+    int8_t txPower;
+    // smoothed round trip time of the downlinks in ms, 0 until measured
+    uint16_t rtt;
+    // pending downlink: index in the downlink pool, LH_GATEWAY_NO_DOWNLINK if none
+    uint8_t downlink;
+    uint8_t downlinkRetries;
+    uint16_t downlinkCounter;
+    unsigned long downlinkSentTime;
+    // selective ack deferred until the end of the burst of the node (LH_MSG_FLAG_MORE)
+    bool isSackPending;
+    unsigned long sackTime;
+    LoRaHomeDedupeWindow rxWindow;
+};
+
+// Notified of the messages received from the nodes, after the ack is sent
+class LoRaHomeGatewayListener
+{
+public:
+    virtual ~LoRaHomeGatewayListener() = default;
+
+    /**
+     * @brief Called for each valid message sent by a node to the gateway
+     *
+     * @param nodeId emitter of the message
+     * @param frame the frame, only valid during the call. LoRaHomeGateway::decodePayload gives the JSON payload,
+     * with the values of the telemetry frames rebuilt. LoRaHomeGateway::unpackReading gives the readings of a batch.
+     */
+    virtual void onNodeMessage(uint8_t nodeId, const LoRaHomeFrameView& frame) = 0;
+};
+
+// Gateway side of the LoRa Home protocol, on the same frame codec as the nodes.
+// Acks are sent before the message is handed to the listener, so the ack latency doesn't depend on the app.
+// Downlinks are sent right after the ack of an uplink of their node, while the node listens.
+// Nodes with several frames in flight get selective acks, once both ends advertised LH_MSG_FLAG_SACK.
+// LH_MSG_FLAG_ADR is only advertised when the radio receives every spreading factor; each node is then
+// answered on the spreading factor of its last uplink.
+class LoRaHomeGateway
+{
+public:
+    LoRaHomeGateway(LoRaHomeRadio& radio, uint16_t networkID = MY_NETWORK_ID,
+                    uint8_t capabilities = LH_MSG_FLAG_MSGPACK | LH_MSG_FLAG_SACK | LH_MSG_FLAG_ADR);
+    virtual ~LoRaHomeGateway() = default;
+
+    inline void setListener(LoRaHomeGatewayListener* listener) { mListener = listener; };
+    uint16_t process(unsigned long now, uint16_t maxFrames = LH_GATEWAY_MAX_FRAMES_PER_PROCESS);
+    bool handleFrame(uint8_t* rawBytesWithCRC, uint8_t length, int16_t snr, int16_t rssi, unsigned long now);
+    DeserializationError decodePayload(const LoRaHomeFrameView& frame, JsonDocument& payload);
+    bool unpackReading(uint8_t nodeId, const JsonDocument& payload, uint8_t index, JsonDocument& reading, unsigned long& time) const;
+    bool queueDownlink(uint8_t nodeId, const JsonDocument& payload);
+
+    inline const LoRaHomeGatewayNode& getNode(uint8_t nodeId) const { return mNodes[nodeId]; };
+    inline uint32_t getRxCount() const { return mRxCount; };
+    inline uint32_t getInvalidCount() const { return mInvalidCount; };
+    inline uint32_t getAckCount() const { return mAckCount; };
+
+protected:
+    void sendAck(uint8_t nodeId, uint16_t counter);
+    void sendSelectiveAck(uint8_t nodeId, const LoRaHomeDedupeWindow& rxWindow);
+    void sendPendingSelectiveAcks(unsigned long now);
+    unsigned long getSelectiveAckDelay(const LoRaHomeGatewayNode& node) const;
+    uint8_t getSpreadingFactor(const LoRaHomeGatewayNode& node) const;
+    void sendDownlink(uint8_t nodeId, unsigned long now);
+    void handleDownlinkAck(LoRaHomeGatewayNode& node, uint16_t counter, unsigned long now);
+    void updateNode(LoRaHomeGatewayNode& node, uint16_t counter, int16_t snr, int16_t rssi, unsigned long now);
+    uint8_t allocateDownlink();
+
+    LoRaHomeRadio& mRadio;
+    LoRaHomeGatewayListener* mListener;
+    uint16_t mNetworkID;
+    uint8_t mCapabilities;
+    LoRaHomeFrame mDownlinkFrame;
+    uint8_t mRxBuffer[LH_FRAME_MAX_SIZE];
+    uint8_t mTxBuffer[LH_FRAME_SACK_SIZE];
+    LoRaHomeGatewayNode mNodes[LH_GATEWAY_NODE_COUNT];
+    // serialized downlinks, shared by the nodes
+    uint8_t mDownlinks[LH_GATEWAY_DOWNLINK_POOL_SIZE][LH_FRAME_MAX_SIZE];
+    uint8_t mDownlinkSizes[LH_GATEWAY_DOWNLINK_POOL_SIZE];
+    // last telemetry keyframe of each node
+    LoRaHomeTelemetryDecoder mTelemetryDecoders[LH_GATEWAY_NODE_COUNT];
+    uint32_t mRxCount;
+    uint32_t mInvalidCount;
+    uint32_t mAckCount;
+    uint8_t mSackPendingCount;
+};
+
+#endif
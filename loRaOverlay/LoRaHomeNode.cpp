@@ -1,11 +1,23 @@
 
+// LoRaNode.h selects the board, it shall be included before LoraConfig.h defines the pins
+#include "LoRaNode.h"
 #include "LoRaHomeNode.h"
 #include <LoRa.h>
-#include "LoRaNode.h"
 #include <ArduinoJson.h>
 #include "LoraConfig.h"
+#include <trace/Trace.h>
+
+#if (LH_TX_WINDOW_SIZE > LH_TX_QUEUE_SIZE) || (LH_TX_WINDOW_SIZE > 8)
+#error "LH_TX_WINDOW_SIZE shall not exceed LH_TX_QUEUE_SIZE nor 8"
+#endif
+
+// AVR cores map the pins to their external interrupt at compile time
+#if defined(LH_ASYNC_RADIO) && defined(__AVR__)
+static_assert(NOT_AN_INTERRUPT != digitalPinToInterrupt(DIO0),
+              "LH_ASYNC_RADIO: DIO0 shall be wired to an external interrupt pin, 2 or 3 on a Uno or a Nano");
+#endif
 
-#define DEBUG
+// #define DEBUG
 
 #ifdef DEBUG
 #define DEBUG_MSG_ONELINE(x) Serial.print(F(x))
@@ -20,12 +32,66 @@
 LoRaHomeNode::LoRaHomeNode(uint8_t nodeId):
   mNodeId(nodeId),
   mTxFrame(MY_NETWORK_ID, nodeId, LH_NODE_ID_GATEWAY, LH_MSG_TYPE_NODE_MSG_ACK_REQ),
-  mAckFrame(MY_NETWORK_ID, nodeId, LH_NODE_ID_GATEWAY, LH_MSG_TYPE_NODE_ACK),
-  mIsTxAvailable(true),
-  mTxRetryCounter(0),
-  mTxCounter(0)
+  mTxInFlight(0),
+  mTxCounter(0),
+  mAckTimeout(ACK_TIMEOUT, ACK_TIMEOUT_MIN, ACK_TIMEOUT_MAX),
+  mTxTimeoutCount(0),
+  mRetrySendMessageInterval(ACK_TIMEOUT),
+  mGatewayCapabilities(0),
+  mIsSackReceived(false),
+  mIsAckPending(false),
+  mDutyCycle(LH_DUTY_CYCLE_PERMILLE),
+  mAdr(LORA_SPREADING_FACTOR, LORA_TX_POWER, LH_ADR_MIN_TX_POWER, LH_ADR_MAX_TX_POWER),
+  mRxSnr(0),
+  mIsAdrReady(false),
+  mTxListener(nullptr),
+  mRxWindowStart(0),
+  mRxWindowEnd(0),
+  mIsRadioSleeping(false),
+  mRadioRxTime(0),
+  mRadioTxTime(0)
+#ifdef LH_ASYNC_RADIO
+  ,mIsTransmitting(false)
+#endif
 {}
 
+#ifdef LH_ASYNC_RADIO
+LoRaHomeNode* LoRaHomeNode::sInstance = nullptr;
+
+/**
+ * @brief RxDone interrupt (DIO0): push the received frame in the Rx ring, nothing else
+ *
+ * @param packetSize number of bytes received
+ */
+void LoRaHomeNode::onRadioReceive(int packetSize)
+{
+  LoRaHomeRxSlot* slot = sInstance->mRxRing.beginWrite();
+  if ((nullptr == slot)
+      || (packetSize > LH_FRAME_MAX_SIZE)
+      || (packetSize < LH_FRAME_MIN_SIZE))
+  {
+    sInstance->flushLoRaFifo();
+    return;
+  }
+  slot->snr = (int16_t)(LoRa.packetSnr() * 10);
+  for (slot->size = 0; slot->size < packetSize; slot->size++)
+  {
+    slot->data[slot->size] = (uint8_t)LoRa.read();
+  }
+  sInstance->mRxRing.commitWrite();
+}
+
+/**
+ * @brief TxDone interrupt (DIO0): the radio is available again, back to Rx mode
+ *
+ */
+void LoRaHomeNode::onRadioTxDone()
+{
+  sInstance->mIsTransmitting = false;
+  sInstance->rxMode();
+}
+#endif
+
 /**
 * initialize LoRa communication with #define settings (pins, SD, bandwidth, coding rate, frequency, sync word)
 * CRC is enabled
@@ -38,15 +104,19 @@ void LoRaHomeNode::setup()
   DEBUG_MSG("--- LoRa Begin");
   DEBUG_MSG_VAR(LORA_FREQUENCY);
 
+  // pins shall be set before begin
+  LoRa.setPins(SS, RST, DIO0);
   while (!LoRa.begin(LORA_FREQUENCY))
   {
     DEBUG_MSG_ONELINE(".");
     delay(500);
   }
-  LoRa.setPins(SS, RST, DIO0);
   DEBUG_MSG("--- setSpreadingFactor");
-  DEBUG_MSG_VAR(LORA_SPREADING_FACTOR);
-  LoRa.setSpreadingFactor(LORA_SPREADING_FACTOR);
+  DEBUG_MSG_VAR(mAdr.getSpreadingFactor());
+  LoRa.setSpreadingFactor(mAdr.getSpreadingFactor());
+  DEBUG_MSG("--- setTxPower");
+  DEBUG_MSG_VAR(mAdr.getTxPower());
+  LoRa.setTxPower(mAdr.getTxPower());
   DEBUG_MSG("--- setSignalBandwidth");
   DEBUG_MSG_VAR(LORA_SIGNAL_BANDWIDTH);
   LoRa.setSignalBandwidth(LORA_SIGNAL_BANDWIDTH);
@@ -61,76 +131,443 @@ void LoRaHomeNode::setup()
   LoRa.setSyncWord(LORA_SYNC_WORD);
   DEBUG_MSG("--- enableCrc");
   LoRa.enableCrc();
-  
+  DEBUG_MSG("--- setPreambleLength");
+  DEBUG_MSG_VAR(LORA_PREAMBLE_LENGTH);
+  LoRa.setPreambleLength(LORA_PREAMBLE_LENGTH);
+
+#ifdef LH_ASYNC_RADIO
+  DEBUG_MSG("--- async radio");
+#if defined(EIMSK) && !defined(EICRB)
+  // INTn is interrupt n on these chips, attachInterrupt() enables it: a limit switch wired to DIO0
+  // would lose its handler to the radio.
+  if (EIMSK & _BV(digitalPinToInterrupt(DIO0)))
+  {
+    DEBUG_MSG("--- DIO0 interrupt already attached");
+    TRACE(TRACE_NODE_INTERRUPT_BUSY, digitalPinToInterrupt(DIO0));
+  }
+#endif
+  sInstance = this;
+  LoRa.onReceive(LoRaHomeNode::onRadioReceive);
+  LoRa.onTxDone(LoRaHomeNode::onRadioTxDone);
+#endif
+
   // set in rx mode.
   this->rxMode();
+  // a random first counter, the frames of a node rebooted within LH_DEDUPE_TIMEOUT are not taken as duplicates.
+  // The radio gives its random bytes from the wideband RSSI, in Rx mode.
+  mTxCounter = ((uint16_t)LoRa.random() << 8) | LoRa.random();
+  mRxWindowStart = millis();
+  mRxWindowEnd = mRxWindowStart + LH_RX_WINDOW_DURATION;
 }
 
 /** 
  * Send a message to the LoRa2MQTT gateway
+ * The message is queued and sent as soon as the previous ones are acknowledged
  * @param payload the JSON payload to be sent
- * @param txCounter the counter of the message to be sent
- * @return true if the message was sent successfully, false otherwise
+ * @param key frames with the same key replace each other in the queue (LH_TX_COALESCE policy)
+ * @param isUrgent the message is sent before the other queued messages, e.g. an alarm
+ * @return true if the message was queued successfully, false otherwise
  */
-bool LoRaHomeNode::sendToGateway(const JsonDocument& payload)
+bool LoRaHomeNode::sendToGateway(const JsonDocument& payload, uint8_t key, bool isUrgent)
 {
   // DEBUG_MSG("LoRaHomeNode::sendToGateway()");
-  if(false == mIsTxAvailable){
-    DEBUG_MSG("--- Tx not available");
-    return false;
-  }
-
-  mIsTxAvailable = false;
-  mTxRetryCounter = 0;
-  
-  // DEBUG_MSG("--- create LoraHomeFrame");
-  // create frame
-  mTxFrame.setCounter(getTxCounter());
   // create payload
   // DEBUG_MSG("--- create LoraHomePayload");
-  JsonDocument jsonDoc = payload;;
+  JsonDocument jsonDoc = payload;
   jsonDoc[MSG_SNR] = LoRa.packetSnr();
   jsonDoc[MSG_RSSI] = LoRa.packetRssi();
-  
-  mTxFrame.setPayload(jsonDoc);
+  // advertise our capabilities until the gateway has advertised its own ones,
+  // and until it acks selectively when both support it: the gateway only learns them from a decoded payload
+  if ((0 != getNodeCapabilities())
+      && ((0 == mGatewayCapabilities)
+          || ((mGatewayCapabilities & getNodeCapabilities() & LH_MSG_FLAG_SACK) && !mIsSackReceived)))
+  {
+    jsonDoc[MSG_CAPABILITIES] = getNodeCapabilities();
+  }
+  // announce the next radio settings, the gateway shall know them before the switch
+  bool isAdrRequest = mAdr.isChangeRequested();
+  if (isAdrRequest)
+  {
+    jsonDoc[MSG_SPREADING_FACTOR] = mAdr.getRequestedSpreadingFactor();
+    jsonDoc[MSG_TX_POWER] = mAdr.getRequestedTxPower();
+  }
 
-  send(mTxFrame, LH_FRAME_MAX_SIZE);
-  mTxRetryCounter++;
+  mTxFrame.setPayload(jsonDoc, getTxPayloadFormat());
+
+  LoRaHomeTxSlot* slot = mTxQueue.push(mTxFrame, key, isUrgent);
+  if (nullptr == slot)
+  {
+    DEBUG_MSG("--- Tx queue full, frame dropped");
+    TRACE(TRACE_NODE_TX_DROPPED, key);
+    return false;
+  }
+  slot->isAdrRequest = isAdrRequest;
 
+  fillTxWindow();
   return true;
 }
 
 /**
- * @brief Retries sending a message to the gateway.
+ * @brief Retries sending the messages waiting for their ack.
  * 
- * This method is called when an acknowledgment (ack) for the message is not received.
- * It checks if the maximum number of retries without a valid ack has been reached.
- * If the maximum retry limit is reached, it sets the transmission availability flag to true and returns.
- * Otherwise, it calls the send() method to resend the message and increments the retry counter.
+ * This method is called when an acknowledgment (ack) for the message is not received, see getNextRetryDelay.
+ * Each frame in flight without ack since the retry interval is sent again, unless the maximum number of
+ * retries is reached. In this case the frame is skipped to enable the next ones.
+ * Frames sent later, e.g. by an ack releasing the window, wait for their own timeout.
+ * The frames due are sent back to back by fillTxWindow, with the new frames the window allows.
  */
 void LoRaHomeNode::retrySendToGateway()
 {
   DEBUG_MSG("LoRaHomeNode::retrySendToGateway()");
+  unsigned long now = millis();
+  uint8_t dueMask(0);
+  for (uint8_t i = 0; i < mTxInFlight; i++)
+  {
+    const LoRaHomeTxSlot* slot = mTxQueue.at(i);
+    if (!slot->isDone && !slot->isDue && (now - slot->sentTime >= mRetrySendMessageInterval))
+    {
+      dueMask |= (1 << i);
+    }
+  }
+  if (0 != dueMask)
+  {
+    if (mTxTimeoutCount < 0xFF)
+    {
+      mTxTimeoutCount++;
+    }
+    for (uint8_t i = 0; i < mTxInFlight; i++)
+    {
+      if (dueMask & (1 << i))
+      {
+        retrySendFrame(i);
+      }
+    }
+  }
+  releaseAckedFrames();
+  fillTxWindow();
+  if (0 != dueMask)
+  {
+    updateRetrySendMessageInterval();
+  }
+}
+
+/**
+ * @brief Get the delay until the oldest frame in flight times out
+ *
+ * Frames already due only wait for the radio, they are sent by fillTxWindow.
+ *
+ * @return unsigned long delay in ms, 0 if a retry is due, the retry interval if no frame is in flight
+ */
+unsigned long LoRaHomeNode::getNextRetryDelay()
+{
+  unsigned long now = millis();
+  unsigned long delay = mRetrySendMessageInterval;
+  for (uint8_t i = 0; i < mTxInFlight; i++)
+  {
+    const LoRaHomeTxSlot* slot = mTxQueue.at(i);
+    if (slot->isDone || slot->isDue)
+    {
+      continue;
+    }
+    unsigned long elapsed = now - slot->sentTime;
+    if (elapsed >= mRetrySendMessageInterval)
+    {
+      return 0;
+    }
+    if (mRetrySendMessageInterval - elapsed < delay)
+    {
+      delay = mRetrySendMessageInterval - elapsed;
+    }
+  }
+  return delay;
+}
+
+/**
+ * @brief Schedule a frame in flight to be sent again by fillTxWindow, or give up if max retry is reached
+ *
+ * @param index position of the frame in the Tx queue
+ */
+void LoRaHomeNode::retrySendFrame(uint8_t index)
+{
+  LoRaHomeTxSlot* slot = mTxQueue.at(index);
+  if (slot->isDone)
+  {
+    return;
+  }
   // Can't received ack for this message, so skip it to enable next message
-  if(MAX_RETRY_NO_VALID_ACK <= mTxRetryCounter){
+  if (MAX_RETRY_NO_VALID_ACK <= slot->retries)
+  {
     DEBUG_MSG_ONELINE("--- Max retry reached for nbr: ");
-    DEBUG_MSG_VAR(mTxFrame.getCounter());
+    DEBUG_MSG_VAR(getTxCounter() + index);
     DEBUG_MSG(" -> Send FAILLURE");
-    mIsTxAvailable = true;
-    mTxRetryCounter = 0;
+    TRACE(TRACE_NODE_TX_FAILED, getTxCounter() + index);
+    slot->isDone = true;
+    // the next frame starts from the estimated timeout, not from the backoff of this one
+    mTxTimeoutCount = 0;
+    mAdr.addLostAck();
+    updateAdr();
+    return;
+  }
+  slot->isDue = true;
+}
+
+/**
+ * @brief Send the frames in flight due for a retry, then the queued frames until the Tx window is full.
+ * Frames in flight have consecutive counters, starting from the Tx counter.
+ * The window is 1 frame (stop and wait) until the gateway acks selectively.
+ * Frames are sent back to back, each one but the last is flagged LH_MSG_FLAG_MORE so that the gateway
+ * doesn't transmit its ack meanwhile.
+ */
+void LoRaHomeNode::fillTxWindow()
+{
+  applyAdr();
+  // radios are half duplex: once a burst is over, the gateway transmits its ack, wait for it or for a retry
+  if (isWaitingForBurstAck())
+  {
+    return;
+  }
+  int8_t index = getNextTxIndex(0);
+  while (0 <= index)
+  {
+    LoRaHomeTxSlot* slot = mTxQueue.at(index);
+    // radio busy or duty cycle budget exhausted, the frame waits for the next call
+    if (!canSend(slot->size))
+    {
+      return;
+    }
+
+    LoRaHomeFrameView txFrame(slot->data, slot->size);
+    if (!slot->isSent)
+    {
+      // the counter is only known now, patch the serialized frame
+      txFrame.setCounter(getTxCounter() + mTxInFlight);
+      slot->isSent = true;
+      slot->isDone = false;
+      slot->isAcked = false;
+      slot->retries = 0;
+      mTxInFlight++;
+    }
+    int8_t nextIndex = getNextTxIndex(index + 1);
+    uint8_t flags = txFrame.getMessageFlags() & ~LH_MSG_FLAG_MORE;
+    txFrame.setMessageFlags((0 <= nextIndex) ? (flags | LH_MSG_FLAG_MORE) : flags);
+    txFrame.updateCRC();
+
+    send(slot->data, slot->size);
+    // the gateway acks the burst after its last frame, the frames of the burst are timed from it
+    for (uint8_t i = 0; i < mTxInFlight; i++)
+    {
+      LoRaHomeTxSlot* burstSlot = mTxQueue.at(i);
+      if (burstSlot->isInBurst)
+      {
+        burstSlot->isInBurst = false;
+        burstSlot->sentTime = millis();
+      }
+    }
+    slot->isInBurst = (0 <= nextIndex);
+    slot->isDue = false;
+    slot->retries++;
+    slot->sentTime = millis();
+    index = nextIndex;
+  }
+}
+
+/**
+ * @brief Check whether the last burst is over and frames of it wait for their ack
+ *
+ * @return true if no frame shall be sent before the ack or a retry
+ */
+bool LoRaHomeNode::isWaitingForBurstAck()
+{
+  bool isWaiting(false);
+  for (uint8_t i = 0; i < mTxInFlight; i++)
+  {
+    const LoRaHomeTxSlot* slot = mTxQueue.at(i);
+    // the next frame of the burst is not sent yet
+    if (slot->isInBurst)
+    {
+      return false;
+    }
+    isWaiting = isWaiting || (!slot->isDone && !slot->isDue);
+  }
+  return isWaiting;
+}
+
+/**
+ * @brief Find the next frame to be sent: a frame in flight due for a retry, else a queued frame the window allows
+ *
+ * @param from first position in the Tx queue to look at
+ * @return int8_t position in the Tx queue, -1 if none
+ */
+int8_t LoRaHomeNode::getNextTxIndex(uint8_t from)
+{
+  for (uint8_t i = from; i < mTxInFlight; i++)
+  {
+    if (mTxQueue.at(i)->isDue)
+    {
+      return i;
+    }
+  }
+  uint8_t index = (from > mTxInFlight) ? from : mTxInFlight;
+  if ((index < getTxWindowSize()) && (nullptr != mTxQueue.at(index)))
+  {
+    return index;
+  }
+  return -1;
+}
+
+/**
+ * @brief Remove from the Tx queue the oldest frames that are acked or given up
+ *
+ */
+void LoRaHomeNode::releaseAckedFrames()
+{
+  while ((0 < mTxInFlight) && mTxQueue.front()->isDone)
+  {
+    // the gateway got the requested settings, a given up request is announced again in the next frames
+    if (mTxQueue.front()->isAdrRequest && mTxQueue.front()->isAcked)
+    {
+      mIsAdrReady = true;
+    }
+    if (nullptr != mTxListener)
+    {
+      mTxListener->onTxReleased(mTxQueue.front()->key, mTxQueue.front()->isAcked);
+    }
+    mTxQueue.pop();
+    mTxInFlight--;
     incrementTxCounter();
+  }
+}
+
+/**
+ * @brief Handle an ack or a selective ack received from the gateway
+ *
+ * A single ack acknowledges its counter only.
+ * A selective ack acknowledges every counter up to its counter, plus the counters flagged in its payload bitmap
+ * (bit i for counter + 1 + i). The missing frames are sent again at once, with the new frames the window allows.
+ *
+ * @param ackFrame the ack received
+ */
+void LoRaHomeNode::handleAck(const LoRaHomeFrameView& ackFrame)
+{
+  // gateway advertises its capabilities in its acks
+  mGatewayCapabilities = ackFrame.getMessageFlags();
+  mIsSackReceived = (LH_MSG_TYPE_GW_SACK == ackFrame.getMessageType());
+  // the spreading factor only changes when the gateway can follow it
+  mAdr.setSpreadingFactorAdjustable(mGatewayCapabilities & LH_MSG_FLAG_ADR);
+  mAdr.addSnrSample(mRxSnr);
+  updateAdr();
+  // position in the Tx queue of the acked frame, wraparound safe
+  int16_t ackIndex = (int16_t)(ackFrame.getCounter() - getTxCounter());
+
+  if (LH_MSG_TYPE_GW_SACK == ackFrame.getMessageType())
+  {
+    uint8_t bitmap = (0 < ackFrame.getPayloadSize()) ? ackFrame.getPayload()[0] : 0;
+    for (int16_t i = 0; (i < mTxInFlight) && (i <= ackIndex); i++)
+    {
+      ackFrameAt(i);
+    }
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      int16_t index = ackIndex + 1 + bit;
+      if ((bitmap & (1 << bit)) && (0 <= index) && (index < mTxInFlight))
+      {
+        ackFrameAt(index);
+      }
+    }
+    // the gateway acks once the burst is over, the frames still in flight are lost
+    for (uint8_t i = 0; i < mTxInFlight; i++)
+    {
+      retrySendFrame(i);
+    }
+  }
+  else if ((0 <= ackIndex) && (ackIndex < mTxInFlight))
+  {
+    DEBUG_MSG_ONELINE("--- ack received for Tx counter: ");
+    DEBUG_MSG_VAR(ackFrame.getCounter());
+    DEBUG_MSG(" -> Send SUCCESS");
+    TRACE(TRACE_NODE_ACK, ackFrame.getCounter());
+    ackFrameAt(ackIndex);
+  }
+  else
+  {
+    DEBUG_MSG_ONELINE("--- ack received but not for this message, ack counter: ");
+    DEBUG_MSG_VAR(ackFrame.getCounter());
+  }
+
+  releaseAckedFrames();
+  // drain the queue
+  fillTxWindow();
+  updateRetrySendMessageInterval();
+}
+
+/**
+ * @brief Mark a frame in flight as acked, and measure the round trip time
+ *
+ * @param index position of the frame in the Tx queue
+ */
+void LoRaHomeNode::ackFrameAt(uint8_t index)
+{
+  LoRaHomeTxSlot* slot = mTxQueue.at(index);
+  if (slot->isDone)
+  {
     return;
   }
+  slot->isDone = true;
+  slot->isAcked = true;
+  mTxTimeoutCount = 0;
+  // Karn's algorithm: the ack of a frame sent several times can't be matched to a transmission
+  if (1 == slot->retries)
+  {
+    mAckTimeout.addSample(millis() - slot->sentTime);
+  }
+}
 
-  send(mTxFrame, LH_FRAME_MAX_SIZE);
-  mTxRetryCounter++;
+/**
+ * @brief Get the number of frames that can be in flight
+ *
+ * @return uint8_t LH_TX_WINDOW_SIZE once the gateway acks selectively, 1 otherwise
+ */
+uint8_t LoRaHomeNode::getTxWindowSize()
+{
+  if ((mGatewayCapabilities & getNodeCapabilities() & LH_MSG_FLAG_SACK) && mIsSackReceived)
+  {
+    return LH_TX_WINDOW_SIZE;
+  }
+  return 1;
 }
 
 /**
-* [receiveLoraMessage description]
-*/
+ * @brief Process the radio: send the pending frames and handle the received one if any.
+ * To be called at each main loop.
+ *
+ * @param payload filled with the payload of the message received, if any
+ * @return true if a message for the node is received
+ */
 bool LoRaHomeNode::receiveLoraMessage(JsonDocument& payload)
 {
+  updateRxWindow();
+  // frames that could not be sent while the radio was busy or the duty cycle exhausted
+  if (mIsAckPending)
+  {
+    sendAck();
+  }
+  fillTxWindow();
+
+#ifdef LH_ASYNC_RADIO
+  // frames are received under interrupt, only drain the Rx ring
+  LoRaHomeRxSlot* slot = mRxRing.front();
+  if (nullptr == slot)
+  {
+    return false;
+  }
+  DEBUG_MSG("LoRaHomeNode::receiveLoraMessage");
+  // parse the LoRa Home frame in place, in the ring
+  LoRaHomeFrameView rxFrame(slot->data, slot->size);
+  mRxSnr = slot->snr;
+  bool isReceived = handleRxFrame(rxFrame, payload);
+  mRxRing.pop();
+  return isReceived;
+#else
   //try to parse packet
   int packetSize = LoRa.parsePacket();
 
@@ -158,13 +595,26 @@ bool LoRaHomeNode::receiveLoraMessage(JsonDocument& payload)
     // read available bytes
     rxMessage[msgSize] = (char)LoRa.read();
   }
-  // create LoRa Home frame
-  LoRaHomeFrame rxFrame;
-  bool noError = rxFrame.createFromRxMessage(rxMessage, msgSize, true);
+  // parse the LoRa Home frame in place, no copy of the payload
+  LoRaHomeFrameView rxFrame(rxMessage, msgSize);
+  mRxSnr = (int16_t)(LoRa.packetSnr() * 10);
+  return handleRxFrame(rxFrame, payload);
+#endif
+}
 
-  if (false == noError)
+/**
+ * @brief Handle a frame received from the radio
+ *
+ * @param rxFrame the frame received
+ * @param payload filled with the payload of the frame if it is a message for the node
+ * @return true if a message for the node is received
+ */
+bool LoRaHomeNode::handleRxFrame(const LoRaHomeFrameView& rxFrame, JsonDocument& payload)
+{
+  if (false == rxFrame.isValid(true))
   {
     DEBUG_MSG("--- bad message received");
+    TRACE(TRACE_NODE_RX_ERROR, 0);
     return false;
   }
 
@@ -180,46 +630,43 @@ bool LoRaHomeNode::receiveLoraMessage(JsonDocument& payload)
 
   // Handle ack message
   if(mNodeId == rxFrame.getNodeIdRecipient()
-     && (rxFrame.getMessageType() == LH_MSG_TYPE_GW_ACK)
+     && ((rxFrame.getMessageType() == LH_MSG_TYPE_GW_ACK) || (rxFrame.getMessageType() == LH_MSG_TYPE_GW_SACK))
      && (rxFrame.getNodeIdEmitter() == LH_NODE_ID_GATEWAY))
   {
-
-      if(mTxFrame.getCounter() == rxFrame.getCounter()) {
-        mIsTxAvailable = true;
-        mTxFrame.clear();
-
-        DEBUG_MSG_ONELINE("--- ack received for Tx counter: ");
-        DEBUG_MSG_VAR(mTxFrame.getCounter());
-        DEBUG_MSG_ONELINE("Rx counter: ");
-        DEBUG_MSG_VAR(rxFrame.getCounter());
-        DEBUG_MSG(" -> Send SUCCESS");
-        incrementTxCounter();
-        return false;
-      }else {
-        DEBUG_MSG_ONELINE("--- ack received but not for this message, ack counter: ");
-        DEBUG_MSG_VAR(rxFrame.getCounter());
-      }
+    handleAck(rxFrame);
+    return false;
   }
 
   // Am I the node invoked for this messages
   if (mNodeId == rxFrame.getNodeIdRecipient())
   {
-    // deserializeJson error
-    DeserializationError error = deserializeJson(payload, rxFrame.getPayload());
-    
+    bool isAckRequested = (rxFrame.getMessageType() == LH_MSG_TYPE_GW_MSG_ACK) || (rxFrame.getMessageType() == LH_MSG_TYPE_NODE_MSG_ACK_REQ);
+    // retransmission because our ack was lost: ack again, without decoding nor delivering the message
+    if (mRxDedupe.isDuplicate(rxFrame.getNodeIdEmitter(), rxFrame.getCounter(), millis()))
+    {
+      DEBUG_MSG("--- duplicate message");
+      TRACE(TRACE_NODE_RX_DUPLICATE, rxFrame.getCounter());
+      if (isAckRequested)
+      {
+        sendAckFor(rxFrame);
+      }
+      return false;
+    }
+    // JSON or MessagePack according to the frame flags
+    DeserializationError error = rxFrame.deserializePayload(payload);
+
     if (error)
     {
-      DEBUG_MSG("--- deserializeJson error");
+      DEBUG_MSG("--- deserialize payload error");
+      TRACE(TRACE_NODE_RX_ERROR, 1);
       return false;
     }
+    // only a message handled is recorded, a retransmission of a message dropped above is handled again
+    mRxDedupe.record(rxFrame.getNodeIdEmitter(), rxFrame.getCounter(), millis());
     // if message received request an ack
-    if ((rxFrame.getMessageType() == LH_MSG_TYPE_GW_MSG_ACK) || (rxFrame.getMessageType() == LH_MSG_TYPE_NODE_MSG_ACK_REQ))
+    if (isAckRequested)
     {
-      mAckFrame.setNodeIdRecipient(rxFrame.getNodeIdEmitter());
-      mAckFrame.setCounter(rxFrame.getCounter());
-
-      send(mAckFrame, LH_FRAME_MIN_SIZE);
-      DEBUG_MSG("--- ack sent");
+      sendAckFor(rxFrame);
     }
   }
   else
@@ -228,34 +675,173 @@ bool LoRaHomeNode::receiveLoraMessage(JsonDocument& payload)
     return false;
   }
 
+  TRACE_VERBOSE(TRACE_NODE_RX, rxFrame.getCounter());
   return true;
 }
 
 /**
  * Returns the interval for retrying to send a message.
+ * Derived from the measured round trip time, doubled at each consecutive retry and randomized
+ * so that colliding nodes don't retry in lockstep.
  *
  * @return The interval for retrying to send a message in milliseconds.
  */
 unsigned long LoRaHomeNode::getRetrySendMessageInterval()
 {
-  return ACK_TIMEOUT;
+  return mRetrySendMessageInterval;
+}
+
+/**
+ * @brief Draw the next retry interval, to be called when the timeout or the retry count change
+ *
+ */
+void LoRaHomeNode::updateRetrySendMessageInterval()
+{
+  unsigned long timeout = mAckTimeout.getBackoffTimeout(mTxTimeoutCount);
+  // up to +25% of jitter
+  mRetrySendMessageInterval = timeout + random(timeout / 4 + 1);
+}
+
+/**
+ * @brief Get the capabilities supported by this node
+ *
+ * @return uint8_t LH_MSG_FLAG_xxx
+ */
+uint8_t LoRaHomeNode::getNodeCapabilities()
+{
+  uint8_t capabilities(0);
+#ifdef LH_USE_MSGPACK
+  capabilities |= LH_MSG_FLAG_MSGPACK;
+#endif
+#if LH_TX_WINDOW_SIZE > 1
+  capabilities |= LH_MSG_FLAG_SACK;
+#endif
+  return capabilities;
+}
+
+/**
+ * @brief Select the payload format to be sent to the gateway.
+ * MessagePack is only used once the gateway advertised it, legacy gateways keep receiving JSON.
+ *
+ * @return uint8_t LH_PAYLOAD_FORMAT_JSON or LH_PAYLOAD_FORMAT_MSGPACK
+ */
+uint8_t LoRaHomeNode::getTxPayloadFormat()
+{
+  if (mGatewayCapabilities & getNodeCapabilities() & LH_MSG_FLAG_MSGPACK)
+  {
+    return LH_PAYLOAD_FORMAT_MSGPACK;
+  }
+  return LH_PAYLOAD_FORMAT_JSON;
+}
+
+/**
+ * @brief Let the ADR decide on new radio settings from the last acks.
+ * New settings are only requested, they are announced in the next frames and applied once one of them is acked.
+ * When too many frames are given up in a row, the default settings are applied without announce.
+ */
+void LoRaHomeNode::updateAdr()
+{
+#ifdef LH_USE_ADR
+  if (mAdr.fallback())
+  {
+    DEBUG_MSG("--- ADR link lost, back to the default settings");
+    TRACE(TRACE_NODE_ADR, (mAdr.getRequestedSpreadingFactor() << 8) | (uint8_t)mAdr.getRequestedTxPower());
+    mIsAdrReady = true;
+    return;
+  }
+  if (mAdr.update())
+  {
+    DEBUG_MSG_ONELINE("--- ADR request, spreading factor: ");
+    DEBUG_MSG_VAR(mAdr.getRequestedSpreadingFactor());
+    DEBUG_MSG_ONELINE("--- ADR request, Tx power: ");
+    DEBUG_MSG_VAR(mAdr.getRequestedTxPower());
+    TRACE(TRACE_NODE_ADR, (mAdr.getRequestedSpreadingFactor() << 8) | (uint8_t)mAdr.getRequestedTxPower());
+  }
+#endif
+}
+
+/**
+ * @brief Switch the radio to the requested settings once announced, when no frame is being transmitted
+ *
+ */
+void LoRaHomeNode::applyAdr()
+{
+  if (!mIsAdrReady || isRadioBusy())
+  {
+    return;
+  }
+  mIsAdrReady = false;
+  mAdr.apply();
+  LoRa.setSpreadingFactor(mAdr.getSpreadingFactor());
+  LoRa.setTxPower(mAdr.getTxPower());
+  // Rx mode is kept by the driver, only the modem settings change
+}
+
+/**
+ * @brief Ack a message received
+ *
+ * @param rxFrame the message to be acked
+ */
+void LoRaHomeNode::sendAckFor(const LoRaHomeFrameView& rxFrame)
+{
+  // only advertise back what the gateway already knows, a legacy gateway expects a plain ack type
+  uint8_t flags = mGatewayCapabilities & getNodeCapabilities() & LH_MSG_FLAGS_MASK;
+  LoRaHomeFrame::serializeAck(mAckBuffer, MY_NETWORK_ID, mNodeId, rxFrame.getNodeIdEmitter(), LH_MSG_TYPE_NODE_ACK | flags, rxFrame.getCounter());
+  sendAck();
+}
+
+/**
+ * @brief Send the ack frame, or keep it pending until the radio is available
+ *
+ */
+void LoRaHomeNode::sendAck()
+{
+  mIsAckPending = !send(mAckBuffer, LH_FRAME_ACK_SIZE);
+  if (!mIsAckPending)
+  {
+    DEBUG_MSG("--- ack sent");
+  }
 }
 
 /**
  * Send a message to the LoRa2MQTT gateway
+ * @return false if the radio is busy and the message is not sent
  */
-void LoRaHomeNode::send(LoRaHomeFrame& frame, uint8_t bufferSize)
+bool LoRaHomeNode::send(LoRaHomeFrame& frame, uint8_t bufferSize)
 {
+  uint8_t txBuffer[bufferSize];
+  uint8_t size = frame.serialize(txBuffer);
+  // DEBUG_MSG("--- LoraHomeFrame serialized");
+  return send(txBuffer, size);
+}
+
+/**
+ * Send a serialized frame to the LoRa2MQTT gateway
+ * In async mode, returns as soon as the frame is in the radio FIFO, Rx mode is restored on TxDone interrupt.
+ * @return false if the radio is busy or the duty cycle budget is exhausted, the frame is not sent
+ */
+bool LoRaHomeNode::send(const uint8_t* txBuffer, uint8_t size)
+{
+  if (!canSend(size))
+  {
+    return false;
+  }
+  unsigned long airtime = getFrameAirtime(size);
+  mDutyCycle.record(millis(), airtime);
+  mRadioTxTime += airtime;
+  // txMode wakes the radio up
+  if (mIsRadioSleeping)
+  {
+    mIsRadioSleeping = false;
+    mRxWindowStart = millis();
+  }
   // DEBUG_MSG("LoRaHomeNode::send");
   // DEBUG_MSG("--- sending LoRa message to LoRa2MQTT gateway");
   DEBUG_MSG_ONELINE("--- Send frame number: ");
-  DEBUG_MSG_VAR(frame.getCounter());
+  DEBUG_MSG_VAR(txBuffer[LH_FRAME_INDEX_COUNTER] | (txBuffer[LH_FRAME_INDEX_COUNTER + 1] << 8));
   DEBUG_MSG_ONELINE("Message type: ");
-  DEBUG_MSG_VAR(frame.getMessageType());
-
-  uint8_t txBuffer[bufferSize];
-  uint8_t size = frame.serialize(txBuffer);
-  // DEBUG_MSG("--- LoraHomeFrame serialized");
+  DEBUG_MSG_VAR(txBuffer[LH_FRAME_INDEX_MESSAGE_TYPE]);
+  TRACE_VERBOSE(TRACE_NODE_TX, txBuffer[LH_FRAME_INDEX_COUNTER] | (txBuffer[LH_FRAME_INDEX_COUNTER + 1] << 8));
 
   this->txMode();
   LoRa.beginPacket();
@@ -264,8 +850,147 @@ void LoRaHomeNode::send(LoRaHomeFrame& frame, uint8_t bufferSize)
     LoRa.write(txBuffer[i]);
     // DEBUG_MSG_VAR(txBuffer[i]);
   }
+#ifdef LH_ASYNC_RADIO
+  mIsTransmitting = true;
+  LoRa.endPacket(true);
+  // Rx mode is restored on TxDone, after the airtime
+  mRxWindowEnd = millis() + airtime + LH_RX_WINDOW_DURATION;
+#else
   LoRa.endPacket();
   this->rxMode();
+  mRxWindowEnd = millis() + LH_RX_WINDOW_DURATION;
+#endif
+  return true;
+}
+
+/**
+ * @brief Check whether a frame can be transmitted now
+ *
+ * @param size size of the frame in bytes
+ * @return true if the radio is available and the frame fits in the duty cycle budget
+ */
+bool LoRaHomeNode::canSend(uint8_t size)
+{
+  return !isRadioBusy() && mDutyCycle.canTransmit(millis(), getFrameAirtime(size));
+}
+
+/**
+ * @brief Get the time on air of a frame with the current radio settings
+ *
+ * @param size size of the frame in bytes
+ * @return unsigned long time on air in ms
+ */
+unsigned long LoRaHomeNode::getFrameAirtime(uint8_t size)
+{
+  return LoRaHomeAirtime::getTimeOnAirMs(mAdr.getSpreadingFactor(), LORA_SIGNAL_BANDWIDTH, LORA_CODING_RATE_DENOMINATOR,
+                                         true, LORA_PREAMBLE_LENGTH, size);
+}
+
+/**
+ * @brief Get the projected time on air of a frame sent to the gateway, so that the app can adapt its payload
+ *
+ * @param payloadSize size of the serialized payload in bytes
+ * @return unsigned long time on air in ms
+ */
+unsigned long LoRaHomeNode::getProjectedAirtime(uint8_t payloadSize)
+{
+  return getFrameAirtime(LH_FRAME_HEADER_SIZE + payloadSize + LH_FRAME_FOOTER_SIZE);
+}
+
+/**
+ * @brief Get the airtime left over the last hour before frames are deferred
+ *
+ * @return unsigned long airtime in ms
+ */
+unsigned long LoRaHomeNode::getRemainingAirtime()
+{
+  return mDutyCycle.getRemainingAirtime(millis());
+}
+
+/**
+ * @brief Check whether a frame is being transmitted
+ *
+ * @return true only in async mode, until the TxDone interrupt
+ */
+bool LoRaHomeNode::isRadioBusy()
+{
+#ifdef LH_ASYNC_RADIO
+  return mIsTransmitting;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Open and close the Rx windows (LH_CLASS_A): the radio sleeps once the window after
+ * the last transmission is over, and listens again every LH_RX_WINDOW_PERIOD ms if not 0
+ */
+void LoRaHomeNode::updateRxWindow()
+{
+#ifdef LH_CLASS_A
+  unsigned long now = millis();
+  if (!mIsRadioSleeping)
+  {
+    if (!isRadioBusy() && !mIsAckPending && ((long)(now - mRxWindowEnd) >= 0))
+    {
+      sleepRadio();
+    }
+  }
+#if LH_RX_WINDOW_PERIOD
+  else if (now - mRxWindowStart >= LH_RX_WINDOW_PERIOD)
+  {
+    DEBUG_MSG("--- Rx window");
+    mIsRadioSleeping = false;
+    mRxWindowStart = now;
+    mRxWindowEnd = now + LH_RX_WINDOW_DURATION;
+    rxMode();
+  }
+#endif
+#endif
+}
+
+/**
+ * @brief Put the radio in sleep mode, the lowest consumption. Any transmission wakes it up.
+ *
+ */
+void LoRaHomeNode::sleepRadio()
+{
+  LoRa.sleep();
+  mIsRadioSleeping = true;
+  mRadioRxTime += millis() - mRxWindowStart;
+}
+
+/**
+ * @brief Get the delay until the radio listens again, the MCU can sleep that long
+ *
+ * @return unsigned long delay in ms, 0 if the radio listens, 0xFFFFFFFF if it only listens after a transmission
+ */
+unsigned long LoRaHomeNode::getNextRxWindowDelay()
+{
+  if (!mIsRadioSleeping)
+  {
+    return 0;
+  }
+#if LH_RX_WINDOW_PERIOD
+  unsigned long elapsed = millis() - mRxWindowStart;
+  return (elapsed >= LH_RX_WINDOW_PERIOD) ? 0 : LH_RX_WINDOW_PERIOD - elapsed;
+#else
+  return 0xFFFFFFFFUL;
+#endif
+}
+
+/**
+ * @brief Get the time spent by the radio in Rx mode
+ *
+ * @return unsigned long time in ms
+ */
+unsigned long LoRaHomeNode::getRadioRxTime()
+{
+  if (mIsRadioSleeping)
+  {
+    return mRadioRxTime;
+  }
+  return mRadioRxTime + (millis() - mRxWindowStart);
 }
 
 /**
@@ -4,6 +4,17 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <loRaOverlay/LoRaHomeFrame.h>
+#include <loRaOverlay/LoRaHomeFrameView.h>
+#include <loRaOverlay/LoRaHomeTxQueue.h>
+#include <loRaOverlay/LoRaHomeRttEstimator.h>
+#include <loRaOverlay/LoRaHomeAirtime.h>
+#include <loRaOverlay/LoRaHomeDutyCycle.h>
+#include <loRaOverlay/LoRaHomeAdr.h>
+#include <loRaOverlay/LoRaHomeDedupe.h>
+#include <loRaOverlay/LoraConfig.h>
+#ifdef LH_ASYNC_RADIO
+#include <loRaOverlay/LoRaHomeRxRing.h>
+#endif
 
 class LoRaHomeNode
 {
@@ -12,26 +23,99 @@ public:
     virtual ~LoRaHomeNode() = default;
 
     void setup();
-    bool sendToGateway(const JsonDocument& payload);
+    bool sendToGateway(const JsonDocument& payload, uint8_t key = LH_TX_NO_KEY, bool isUrgent = false);
     void retrySendToGateway();
     bool receiveLoraMessage(JsonDocument& payload);
     unsigned long getRetrySendMessageInterval();
-    inline bool isWaitingForAck() { return !mIsTxAvailable; };
+    unsigned long getNextRetryDelay();
+    inline const LoRaHomeRttEstimator& getAckTimeoutEstimator() { return mAckTimeout; };
+    inline bool isWaitingForAck() { return 0 != mTxInFlight; };
     inline uint16_t getTxCounter() { return mTxCounter; };
+    bool isRadioBusy();
+    inline bool isRadioSleeping() { return mIsRadioSleeping; };
+    unsigned long getNextRxWindowDelay();
+    unsigned long getRadioRxTime();
+    inline unsigned long getRadioTxTime() { return mRadioTxTime; };
+    unsigned long getProjectedAirtime(uint8_t payloadSize);
+    unsigned long getRemainingAirtime();
+    inline uint8_t getTxQueueSize() { return mTxQueue.size(); };
+    inline uint16_t getTxDroppedCount() { return mTxQueue.getDroppedCount(); };
+    inline uint16_t getRxDuplicateCount() { return mRxDedupe.getDuplicateCount(); };
+    inline const LoRaHomeAdr& getAdr() { return mAdr; };
+    inline void setTxListener(LoRaHomeTxListener* listener) { mTxListener = listener; };
 
 protected:
-    void send(LoRaHomeFrame& frame, uint8_t bufferSize);
+    bool send(LoRaHomeFrame& frame, uint8_t bufferSize);
+    bool send(const uint8_t* txBuffer, uint8_t size);
+    void sendAck();
+    void sendAckFor(const LoRaHomeFrameView& rxFrame);
+    bool canSend(uint8_t size);
+    unsigned long getFrameAirtime(uint8_t size);
+    bool handleRxFrame(const LoRaHomeFrameView& rxFrame, JsonDocument& payload);
+    void fillTxWindow();
+    void retrySendFrame(uint8_t index);
+    bool isWaitingForBurstAck();
+    int8_t getNextTxIndex(uint8_t from);
+    void releaseAckedFrames();
+    void handleAck(const LoRaHomeFrameView& ackFrame);
+    void ackFrameAt(uint8_t index);
+    void updateRetrySendMessageInterval();
+    uint8_t getTxWindowSize();
     void rxMode();
+    void updateRxWindow();
+    void sleepRadio();
     void txMode();
     void flushLoRaFifo();
     inline void incrementTxCounter() { mTxCounter++; };
+    uint8_t getNodeCapabilities();
+    uint8_t getTxPayloadFormat();
+    void updateAdr();
+    void applyAdr();
 
     uint8_t mNodeId;
     LoRaHomeFrame mTxFrame;
-    LoRaHomeFrame mAckFrame;
-    bool mIsTxAvailable;
-    uint8_t mTxRetryCounter;
+    // serialized ack, header only: a LoRaHomeFrame would carry a payload buffer
+    uint8_t mAckBuffer[LH_FRAME_ACK_SIZE];
+    LoRaHomeTxQueue mTxQueue;
+    // number of frames sent and not yet released, at the front of mTxQueue
+    uint8_t mTxInFlight;
+    // counter of the oldest frame in flight
     uint16_t mTxCounter;
+    LoRaHomeRttEstimator mAckTimeout;
+    // consecutive retries without any ack, for the exponential backoff
+    uint8_t mTxTimeoutCount;
+    unsigned long mRetrySendMessageInterval;
+    // LH_MSG_FLAG_xxx advertised by the gateway in its acks
+    uint8_t mGatewayCapabilities;
+    // the last ack was selective: the gateway knows the capabilities of the node
+    bool mIsSackReceived;
+    // ack not sent yet because the radio was busy
+    bool mIsAckPending;
+    LoRaHomeDutyCycle mDutyCycle;
+    LoRaHomeAdr mAdr;
+    // SNR of the last frame received, in tenths of dB
+    int16_t mRxSnr;
+    // a frame carrying the requested radio settings is released, they can be applied
+    bool mIsAdrReady;
+    LoRaHomeTxListener* mTxListener;
+    LoRaHomeDedupeCache mRxDedupe;
+    // Rx window: the radio listens from mRxWindowStart, at least until mRxWindowEnd (LH_CLASS_A)
+    unsigned long mRxWindowStart;
+    unsigned long mRxWindowEnd;
+    bool mIsRadioSleeping;
+    // time spent by the radio in Rx and Tx, for power estimation
+    unsigned long mRadioRxTime;
+    unsigned long mRadioTxTime;
+
+#ifdef LH_ASYNC_RADIO
+    static void onRadioReceive(int packetSize);
+    static void onRadioTxDone();
+    // instance served by the radio interrupts
+    static LoRaHomeNode* sInstance;
+
+    LoRaHomeRxRing mRxRing;
+    volatile bool mIsTransmitting;
+#endif
 };
 
 #endif
\ No newline at end of file
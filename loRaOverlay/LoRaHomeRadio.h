@@ -0,0 +1,58 @@
+#ifndef LORAHOMERADIO_H
+#define LORAHOMERADIO_H
+
+#include <stdint.h>
+
+// Radio backend of LoRaHomeGateway: a real transceiver driver, or a simulated stand-in on a host.
+// The backend owns the modem settings, and the inverted IQ of the gateway Tx.
+// A single channel backend keeps LORA_SPREADING_FACTOR, the default implementations below fit it.
+class LoRaHomeRadio
+{
+public:
+    virtual ~LoRaHomeRadio() = default;
+
+    /**
+     * @brief Get the next frame received, without blocking
+     *
+     * @param buffer filled with the raw frame, CRC included
+     * @param maxSize size of buffer
+     * @param snr filled with the SNR of the frame, in tenths of dB
+     * @param rssi filled with the RSSI of the frame, in dBm
+     * @return uint8_t size of the frame, 0 if none
+     */
+    virtual uint8_t receive(uint8_t* buffer, uint8_t maxSize, int16_t& snr, int16_t& rssi) = 0;
+
+    /**
+     * @brief Transmit a frame, the radio is back in Rx mode afterwards
+     *
+     * @param buffer raw frame, CRC included
+     * @param size size of the frame
+     * @return true if transmitted
+     */
+    virtual bool send(const uint8_t* buffer, uint8_t size) = 0;
+
+    /**
+     * @brief Tell whether every spreading factor is received at once, as by a multi channel concentrator.
+     * Nodes only change their spreading factor (ADR) when the gateway can follow them.
+     *
+     * @return true if the backend receives every spreading factor
+     */
+    virtual bool isMultiSpreadingFactor() const { return false; }
+
+    /**
+     * @brief Get the spreading factor of the last frame received
+     *
+     * @return uint8_t 7 to 12, 0 if unknown
+     */
+    virtual uint8_t getRxSpreadingFactor() const { return 0; }
+
+    /**
+     * @brief Select the spreading factor of the next transmission, the one its recipient listens on.
+     * Called before each transmission.
+     *
+     * @param spreadingFactor 7 to 12
+     */
+    virtual void setTxSpreadingFactor(uint8_t spreadingFactor) { (void)spreadingFactor; }
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "LoRaHomeRadioFile.h"
+
+/**
+ * @brief Construct a new LoRaHomeRadioFile over opened streams
+ *
+ * @param rxStream stream of the received frames
+ * @param txStream stream of the sent frames, nullptr to discard them
+ */
+LoRaHomeRadioFile::LoRaHomeRadioFile(FILE* rxStream, FILE* txStream):
+    mRxStream(rxStream),
+    mTxStream(txStream)
+{
+}
+
+/**
+ * @brief Read the next record of the Rx stream. Records of frames larger than maxSize are skipped.
+ *
+ * @return uint8_t size of the frame, 0 at the end of the stream or on a truncated record
+ */
+uint8_t LoRaHomeRadioFile::receive(uint8_t* buffer, uint8_t maxSize, int16_t& snr, int16_t& rssi)
+{
+    uint8_t header[5];
+    uint8_t size(0);
+    do
+    {
+        if (1 != fread(header, sizeof(header), 1, mRxStream))
+        {
+            return 0;
+        }
+        size = header[0];
+        if (size > maxSize)
+        {
+            // the gateway could not receive the frame. Read and discarded, pipes and sockets can't seek.
+            for (uint8_t i = 0; i < size; i++)
+            {
+                if (EOF == fgetc(mRxStream))
+                {
+                    return 0;
+                }
+            }
+        }
+    } while (size > maxSize);
+    snr = (int16_t)(header[1] | (header[2] << 8));
+    rssi = (int16_t)(header[3] | (header[4] << 8));
+    if ((0 != size) && (1 != fread(buffer, size, 1, mRxStream)))
+    {
+        return 0;
+    }
+    return size;
+}
+
+/**
+ * @brief Append a record to the Tx stream
+ *
+ * @return true if written or discarded
+ */
+bool LoRaHomeRadioFile::send(const uint8_t* buffer, uint8_t size)
+{
+    if (nullptr == mTxStream)
+    {
+        return true;
+    }
+    return writeRecord(mTxStream, buffer, size, 0, 0);
+}
+
+/**
+ * @brief Write a record, e.g. to build a simulated Rx stream
+ *
+ * @param stream the stream to write to
+ * @param buffer raw frame, CRC included
+ * @param size size of the frame
+ * @param snr SNR in tenths of dB
+ * @param rssi RSSI in dBm
+ * @return true if written
+ */
+bool LoRaHomeRadioFile::writeRecord(FILE* stream, const uint8_t* buffer, uint8_t size, int16_t snr, int16_t rssi)
+{
+    uint8_t header[5] = {
+        size,
+        (uint8_t)(snr & 0xff), (uint8_t)((snr >> 8) & 0xff),
+        (uint8_t)(rssi & 0xff), (uint8_t)((rssi >> 8) & 0xff)
+    };
+    return (1 == fwrite(header, sizeof(header), 1, stream))
+        && ((0 == size) || (1 == fwrite(buffer, size, 1, stream)));
+}
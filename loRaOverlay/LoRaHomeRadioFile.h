@@ -0,0 +1,27 @@
+#ifndef LORAHOMERADIOFILE_H
+#define LORAHOMERADIOFILE_H
+
+#include <stdio.h>
+#include <loRaOverlay/LoRaHomeRadio.h>
+
+// Simulated radio of a host gateway: frames are read from and written to streams
+// (regular files, pipes or sockets opened with fdopen).
+// Each record is: size (1 byte), SNR in tenths of dB (2 bytes LE), RSSI (2 bytes LE), frame.
+// Sent frames are written with a null SNR and RSSI.
+class LoRaHomeRadioFile : public LoRaHomeRadio
+{
+public:
+    LoRaHomeRadioFile(FILE* rxStream, FILE* txStream);
+    virtual ~LoRaHomeRadioFile() = default;
+
+    uint8_t receive(uint8_t* buffer, uint8_t maxSize, int16_t& snr, int16_t& rssi) override;
+    bool send(const uint8_t* buffer, uint8_t size) override;
+
+    static bool writeRecord(FILE* stream, const uint8_t* buffer, uint8_t size, int16_t snr, int16_t rssi);
+
+private:
+    FILE* mRxStream;
+    FILE* mTxStream;
+};
+
+#endif
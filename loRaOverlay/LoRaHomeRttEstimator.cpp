@@ -0,0 +1,89 @@
+#include "LoRaHomeRttEstimator.h"
+
+/**
+ * @brief Construct a new LoRaHomeRttEstimator, without any sample yet
+ *
+ * @param initialTimeout timeout used until the first sample
+ * @param minTimeout lower bound of the timeout
+ * @param maxTimeout upper bound of the timeout, also applied to the backoff
+ */
+LoRaHomeRttEstimator::LoRaHomeRttEstimator(unsigned long initialTimeout,
+                                           unsigned long minTimeout,
+                                           unsigned long maxTimeout):
+    mMinTimeout(minTimeout),
+    mMaxTimeout(maxTimeout),
+    mTimeout(initialTimeout),
+    mSmoothedRtt8(0),
+    mRttVariance4(0),
+    mMinRtt(0),
+    mMaxRtt(0),
+    mSampleCount(0)
+{
+}
+
+/**
+ * @brief Add a round trip time measurement and update the timeout.
+ * Only frames acked at their first transmission shall be sampled (Karn's algorithm).
+ *
+ * @param rtt time between the transmission of a frame and the reception of its ack
+ */
+void LoRaHomeRttEstimator::addSample(unsigned long rtt)
+{
+    if (0 == mSampleCount)
+    {
+        mSmoothedRtt8 = rtt << 3;
+        mRttVariance4 = rtt << 1; // rtt / 2, scaled by 4
+        mMinRtt = rtt;
+        mMaxRtt = rtt;
+    }
+    else
+    {
+        // srtt = 7/8 srtt + 1/8 rtt, rttvar = 3/4 rttvar + 1/4 |srtt - rtt|
+        long delta = (long)rtt - (long)(mSmoothedRtt8 >> 3);
+        mSmoothedRtt8 += delta;
+        if (delta < 0)
+        {
+            delta = -delta;
+        }
+        mRttVariance4 += delta - (long)(mRttVariance4 >> 2);
+        if (rtt < mMinRtt)
+        {
+            mMinRtt = rtt;
+        }
+        if (rtt > mMaxRtt)
+        {
+            mMaxRtt = rtt;
+        }
+    }
+    if (mSampleCount < 0xFFFF)
+    {
+        mSampleCount++;
+    }
+
+    // timeout = srtt + 4 * rttvar
+    mTimeout = (mSmoothedRtt8 >> 3) + mRttVariance4;
+    if (mTimeout < mMinTimeout)
+    {
+        mTimeout = mMinTimeout;
+    }
+    if (mTimeout > mMaxTimeout)
+    {
+        mTimeout = mMaxTimeout;
+    }
+}
+
+/**
+ * @brief Get the timeout after several consecutive timeouts, doubled each time (exponential backoff)
+ *
+ * @param timeoutCount number of consecutive timeouts, 0 for the first transmission
+ * @return unsigned long the timeout, bounded to the max timeout
+ */
+unsigned long LoRaHomeRttEstimator::getBackoffTimeout(uint8_t timeoutCount) const
+{
+    unsigned long timeout = mTimeout;
+    for (uint8_t i = 0; (i < timeoutCount) && (timeout < mMaxTimeout); i++)
+    {
+        timeout <<= 1;
+    }
+    return (timeout < mMaxTimeout) ? timeout : mMaxTimeout;
+}
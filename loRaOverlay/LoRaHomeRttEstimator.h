@@ -0,0 +1,38 @@
+#ifndef LORAHOMERTTESTIMATOR_H
+#define LORAHOMERTTESTIMATOR_H
+
+#include <stdint.h>
+
+// Round trip time estimator (Jacobson/Karels) used to derive the ack timeout.
+// All durations are in ms.
+class LoRaHomeRttEstimator
+{
+public:
+    LoRaHomeRttEstimator(unsigned long initialTimeout, unsigned long minTimeout, unsigned long maxTimeout);
+    virtual ~LoRaHomeRttEstimator() = default;
+
+    void addSample(unsigned long rtt);
+    unsigned long getTimeout() const { return mTimeout; };
+    unsigned long getBackoffTimeout(uint8_t timeoutCount) const;
+
+    unsigned long getSmoothedRtt() const { return mSmoothedRtt8 >> 3; };
+    unsigned long getRttVariance() const { return mRttVariance4 >> 2; };
+    unsigned long getMinRtt() const { return mMinRtt; };
+    unsigned long getMaxRtt() const { return mMaxRtt; };
+    unsigned long getMinTimeout() const { return mMinTimeout; };
+    unsigned long getMaxTimeout() const { return mMaxTimeout; };
+    uint16_t getSampleCount() const { return mSampleCount; };
+
+private:
+    unsigned long mMinTimeout;
+    unsigned long mMaxTimeout;
+    unsigned long mTimeout;
+    // scaled by 8 and 4 to keep the fractional part in integer arithmetic
+    unsigned long mSmoothedRtt8;
+    unsigned long mRttVariance4;
+    unsigned long mMinRtt;
+    unsigned long mMaxRtt;
+    uint16_t mSampleCount;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "LoRaHomeRxRing.h"
+
+// one slot is kept empty to distinguish full from empty
+#define NEXT_INDEX(index) (((index) + 1) % (LH_RX_RING_SIZE))
+
+/**
+ * @brief Construct a new empty LoRaHomeRxRing
+ *
+ */
+LoRaHomeRxRing::LoRaHomeRxRing():
+    mHead(0),
+    mTail(0),
+    mOverrunCount(0)
+{
+}
+
+/**
+ * @brief Get the slot to be filled by the producer
+ *
+ * @return LoRaHomeRxSlot* nullptr if the ring is full, the frame is then lost
+ */
+LoRaHomeRxSlot* LoRaHomeRxRing::beginWrite()
+{
+    if (NEXT_INDEX(mHead) == mTail)
+    {
+        mOverrunCount++;
+        return nullptr;
+    }
+    return &mSlots[mHead];
+}
+
+/**
+ * @brief Publish the slot filled by the producer to the consumer
+ *
+ */
+void LoRaHomeRxRing::commitWrite()
+{
+    mHead = NEXT_INDEX(mHead);
+}
+
+/**
+ * @brief Get the oldest received frame
+ *
+ * @return LoRaHomeRxSlot* nullptr if the ring is empty
+ */
+LoRaHomeRxSlot* LoRaHomeRxRing::front()
+{
+    if (mHead == mTail)
+    {
+        return nullptr;
+    }
+    return &mSlots[mTail];
+}
+
+/**
+ * @brief Release the oldest received frame, its slot can be reused by the producer
+ *
+ */
+void LoRaHomeRxRing::pop()
+{
+    if (mHead != mTail)
+    {
+        mTail = NEXT_INDEX(mTail);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef LORAHOMERXRING_H
+#define LORAHOMERXRING_H
+
+#include <Arduino.h>
+#include <loRaOverlay/LoRaHomeFrame.h>
+#include <loRaOverlay/LoraConfig.h>
+
+struct LoRaHomeRxSlot
+{
+    uint8_t size;
+    // in tenths of dB, read when the frame is received
+    int16_t snr;
+    uint8_t data[LH_FRAME_MAX_SIZE];
+};
+
+// Lock free single producer / single consumer ring of received frames.
+// The producer is the radio interrupt, the consumer is the main loop.
+// Each index is only written by one side, and fits in one byte so it is read atomically on AVR.
+class LoRaHomeRxRing
+{
+public:
+    LoRaHomeRxRing();
+    virtual ~LoRaHomeRxRing() = default;
+
+    // producer side
+    LoRaHomeRxSlot* beginWrite();
+    void commitWrite();
+
+    // consumer side
+    LoRaHomeRxSlot* front();
+    void pop();
+
+    inline uint16_t getOverrunCount() const { return mOverrunCount; };
+
+private:
+    LoRaHomeRxSlot mSlots[LH_RX_RING_SIZE];
+    volatile uint8_t mHead; // next slot to be written, only written by the producer
+    volatile uint8_t mTail; // next slot to be read, only written by the consumer
+    volatile uint16_t mOverrunCount;
+};
+
+#endif
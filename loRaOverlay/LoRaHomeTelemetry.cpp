@@ -0,0 +1,177 @@
+#include "LoRaHomeTelemetry.h"
+
+#if LH_TELEMETRY_MAX_FIELDS > 16
+#error "LH_TELEMETRY_MAX_FIELDS shall not exceed 16"
+#endif
+
+/**
+ * @brief Construct a new LoRaHomeTelemetry without field
+ *
+ * @param keyframeInterval a keyframe is sent at least every keyframeInterval calls of buildPayload
+ */
+LoRaHomeTelemetry::LoRaHomeTelemetry(uint8_t keyframeInterval):
+    mFieldCount(0),
+    mKeyframeInterval(keyframeInterval),
+    mIntervalCount(0),
+    mHasBase(false),
+    mIsKeyframeRequired(false),
+    mKeyframeSeq(0),
+    mBaseSeq(0),
+    mTxKey(LH_TELEMETRY_KEY),
+    mKeyframeTxKey(0),
+    mSentMask(0),
+    mIsKeyframeSent(false),
+    mSentCount(0),
+    mSuppressedCount(0)
+{
+}
+
+/**
+ * @brief Register a field, before the first call of buildPayload
+ *
+ * @param key JSON key of the field, the string shall outlive the telemetry
+ * @param deadband the field is reported when it moves strictly more than deadband from the last acked value
+ * @return int8_t index of the field, -1 if LH_TELEMETRY_MAX_FIELDS is reached
+ */
+int8_t LoRaHomeTelemetry::addField(const char* key, int32_t deadband)
+{
+    if (LH_TELEMETRY_MAX_FIELDS <= mFieldCount)
+    {
+        return -1;
+    }
+    Field& field = mFields[mFieldCount];
+    field.key = key;
+    field.deadband = deadband;
+    field.value = 0;
+    field.base = 0;
+    field.reported = 0;
+    field.sent = 0;
+    // the new field is only known by the gateway after the next keyframe
+    mHasBase = false;
+    return mFieldCount++;
+}
+
+/**
+ * @brief Update the current value of a field
+ *
+ * @param index as returned by addField
+ * @param value in the unit of the field
+ */
+void LoRaHomeTelemetry::setValue(uint8_t index, int32_t value)
+{
+    if (index < mFieldCount)
+    {
+        mFields[index].value = value;
+    }
+}
+
+/**
+ * @brief Build the payload of the current interval, to be called at each transmission interval.
+ * A keyframe is built when forced, every keyframe interval, until a keyframe is acked,
+ * or after a keyframe not acked in time.
+ * The payload is not cleared, the app can add its own keys.
+ *
+ * @param payload filled with the fields to be sent
+ * @param isKeyframeForced send every field now, e.g. on an app event
+ * @return true if a frame shall be sent with getTxKey()
+ * @return false if no field moved out of its deadband, nothing to send
+ */
+bool LoRaHomeTelemetry::buildPayload(JsonDocument& payload, bool isKeyframeForced)
+{
+    mIntervalCount++;
+    bool isKeyframe = isKeyframeForced || !mHasBase || mIsKeyframeRequired || (mIntervalCount >= mKeyframeInterval);
+    uint16_t mask(0);
+
+    if (isKeyframe)
+    {
+        for (uint8_t i = 0; i < mFieldCount; i++)
+        {
+            payload[mFields[i].key] = mFields[i].value;
+            mask |= (1 << i);
+        }
+        mKeyframeSeq++;
+        payload[MSG_TELEMETRY_KEYFRAME] = mKeyframeSeq;
+        mIntervalCount = 0;
+        mIsKeyframeRequired = false;
+    }
+    else
+    {
+        JsonObject delta;
+        for (uint8_t i = 0; i < mFieldCount; i++)
+        {
+            Field& field = mFields[i];
+            int32_t change = field.value - field.reported;
+            if ((change > field.deadband) || (change < -field.deadband))
+            {
+                if (0 == mask)
+                {
+                    delta = payload[MSG_TELEMETRY_DELTA].to<JsonObject>();
+                }
+                delta[field.key] = field.value - field.base;
+                mask |= (1 << i);
+            }
+        }
+        if (0 == mask)
+        {
+            mSuppressedCount++;
+            return false;
+        }
+        payload[MSG_TELEMETRY_KEYFRAME] = mBaseSeq;
+    }
+
+    for (uint8_t i = 0; i < mFieldCount; i++)
+    {
+        mFields[i].sent = mFields[i].value;
+    }
+    mSentMask = mask;
+    mIsKeyframeSent = isKeyframe;
+    // a new key for each frame, the ack of an older frame is not matched to this content
+    mTxKey = LH_TELEMETRY_KEY | ((mTxKey + 1) & ~LH_TELEMETRY_KEY_MASK);
+    if (isKeyframe)
+    {
+        mKeyframeTxKey = mTxKey;
+    }
+    mSentCount++;
+    return true;
+}
+
+/**
+ * @brief Commit the content of the last frame built once acked by the gateway.
+ * Register the telemetry with LoRaHomeNode::setTxListener.
+ *
+ * @param key key of the frame released
+ * @param isAcked false if the frame is given up, the fields will be reported again
+ */
+void LoRaHomeTelemetry::onTxReleased(uint8_t key, bool isAcked)
+{
+    if (key == mKeyframeTxKey)
+    {
+        mKeyframeTxKey = 0;
+        // the gateway may have received it anyway: the next deltas would be applied to it
+        if (!isAcked || (key != mTxKey))
+        {
+            mIsKeyframeRequired = true;
+        }
+    }
+    if (!isAcked || (key != mTxKey) || (0 == mSentMask))
+    {
+        return;
+    }
+    for (uint8_t i = 0; i < mFieldCount; i++)
+    {
+        if (mSentMask & (1 << i))
+        {
+            mFields[i].reported = mFields[i].sent;
+            if (mIsKeyframeSent)
+            {
+                mFields[i].base = mFields[i].sent;
+            }
+        }
+    }
+    if (mIsKeyframeSent)
+    {
+        mHasBase = true;
+        mBaseSeq = mKeyframeSeq;
+    }
+    mSentMask = 0;
+}
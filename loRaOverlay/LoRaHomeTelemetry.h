@@ -0,0 +1,75 @@
+#ifndef LORAHOMETELEMETRY_H
+#define LORAHOMETELEMETRY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <loRaOverlay/LoRaHomeTxQueue.h>
+#include <loRaOverlay/LoraConfig.h>
+
+// Tx queue keys of the telemetry frames, the low nibble is a sequence number
+const uint8_t LH_TELEMETRY_KEY = 0xE0;
+const uint8_t LH_TELEMETRY_KEY_MASK = 0xF0;
+
+// Report by exception between the app (LoRaNode) and the radio (LoRaHomeNode).
+// Fields are integers in the unit chosen by the app (e.g. tenths of degree).
+// A keyframe holds every field, flat in the payload as before. The other frames only hold
+// the fields that moved out of their deadband since the last acked report, as deltas to the
+// last acked keyframe under MSG_TELEMETRY_DELTA. Deltas don't depend on the previous frames,
+// so a lost frame never corrupts the values rebuilt by the gateway. Every frame carries under
+// MSG_TELEMETRY_KEYFRAME the sequence number of its keyframe: the gateway may hold a keyframe whose
+// ack was lost, deltas to another keyframe are then rejected until the next keyframe.
+// The gateway rebuilds the values with LoRaHomeTelemetryDecoder.
+class LoRaHomeTelemetry : public LoRaHomeTxListener
+{
+public:
+    LoRaHomeTelemetry(uint8_t keyframeInterval = LH_TELEMETRY_KEYFRAME_INTERVAL);
+    virtual ~LoRaHomeTelemetry() = default;
+
+    int8_t addField(const char* key, int32_t deadband);
+    void setValue(uint8_t index, int32_t value);
+    inline int32_t getValue(uint8_t index) const { return mFields[index].value; };
+
+    bool buildPayload(JsonDocument& payload, bool isKeyframeForced = false);
+    inline uint8_t getTxKey() const { return mTxKey; };
+    void onTxReleased(uint8_t key, bool isAcked) override;
+
+    inline uint16_t getSentCount() const { return mSentCount; };
+    inline uint16_t getSuppressedCount() const { return mSuppressedCount; };
+
+private:
+    struct Field
+    {
+        const char* key;
+        int32_t deadband;
+        int32_t value;
+        // values of the last acked keyframe, reference of the deltas
+        int32_t base;
+        // last value acked by the gateway, reference of the deadband
+        int32_t reported;
+        // value in the frame waiting for its ack
+        int32_t sent;
+    };
+
+    Field mFields[LH_TELEMETRY_MAX_FIELDS];
+    uint8_t mFieldCount;
+    uint8_t mKeyframeInterval;
+    // intervals since the last keyframe
+    uint8_t mIntervalCount;
+    // a keyframe is acked, deltas can be sent
+    bool mHasBase;
+    // a keyframe was given up or acked too late, the gateway may hold another keyframe than the base
+    bool mIsKeyframeRequired;
+    // sequence numbers of the last keyframe built and of the base keyframe
+    uint8_t mKeyframeSeq;
+    uint8_t mBaseSeq;
+    uint8_t mTxKey;
+    // key of the keyframe waiting for its ack, 0 if none
+    uint8_t mKeyframeTxKey;
+    // fields of the frame waiting for its ack, bit i for field i
+    uint16_t mSentMask;
+    bool mIsKeyframeSent;
+    uint16_t mSentCount;
+    uint16_t mSuppressedCount;
+};
+
+#endif
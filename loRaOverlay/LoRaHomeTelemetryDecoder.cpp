@@ -0,0 +1,45 @@
+#include "LoRaHomeTelemetryDecoder.h"
+
+/**
+ * @brief Rebuild the full values of a telemetry payload.
+ * A keyframe updates the stored keyframe. The deltas of a delta frame are replaced by the values.
+ *
+ * @param payload payload received, deltas are replaced by values in place
+ * @return true if the payload holds the values
+ * @return false if the deltas refer to another keyframe, they are removed from the payload
+ */
+bool LoRaHomeTelemetryDecoder::decode(JsonDocument& payload)
+{
+    JsonObject delta = payload[MSG_TELEMETRY_DELTA];
+    if (delta.isNull())
+    {
+        for (JsonPair field : payload.as<JsonObject>())
+        {
+            mKeyframe[field.key()] = field.value();
+        }
+        return true;
+    }
+    if (mKeyframe[MSG_TELEMETRY_KEYFRAME].isNull() ||
+        (mKeyframe[MSG_TELEMETRY_KEYFRAME].as<uint8_t>() != payload[MSG_TELEMETRY_KEYFRAME].as<uint8_t>()))
+    {
+        payload.remove(MSG_TELEMETRY_DELTA);
+        return false;
+    }
+    for (JsonPair field : delta)
+    {
+        payload[field.key()] = mKeyframe[field.key()].as<int32_t>() + field.value().as<int32_t>();
+    }
+    payload.remove(MSG_TELEMETRY_DELTA);
+    return true;
+}
+
+/**
+ * @brief Tell whether a payload was built by LoRaHomeTelemetry
+ *
+ * @param payload payload received
+ * @return true if it carries a keyframe sequence number
+ */
+bool LoRaHomeTelemetryDecoder::isTelemetry(const JsonDocument& payload)
+{
+    return !payload[MSG_TELEMETRY_KEYFRAME].isNull();
+}
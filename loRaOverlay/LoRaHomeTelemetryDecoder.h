@@ -0,0 +1,25 @@
+#ifndef LORAHOMETELEMETRYDECODER_H
+#define LORAHOMETELEMETRYDECODER_H
+
+#include <ArduinoJson.h>
+#include <loRaOverlay/LoraConfig.h>
+
+// Gateway side of LoRaHomeTelemetry, one per node: rebuild the values of the delta frames
+// from the last keyframe received. Arduino free, so that a host gateway can use it.
+class LoRaHomeTelemetryDecoder
+{
+public:
+    LoRaHomeTelemetryDecoder() = default;
+    virtual ~LoRaHomeTelemetryDecoder() = default;
+
+    bool decode(JsonDocument& payload);
+    inline const JsonDocument& getKeyframe() const { return mKeyframe; };
+
+    static bool isTelemetry(const JsonDocument& payload);
+
+private:
+    // last keyframe received from the node
+    JsonDocument mKeyframe;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "LoRaHomeTxQueue.h"
+
+/**
+ * @brief Construct a new empty LoRaHomeTxQueue
+ *
+ * @param dropPolicy LH_TX_DROP_OLDEST, LH_TX_DROP_NEWEST or LH_TX_COALESCE
+ */
+LoRaHomeTxQueue::LoRaHomeTxQueue(uint8_t dropPolicy):
+    mDropPolicy(dropPolicy),
+    mCount(0),
+    mDroppedCount(0)
+{
+    for (uint8_t i = 0; i < LH_TX_QUEUE_SIZE; i++)
+    {
+        mOrder[i] = i;
+    }
+}
+
+/**
+ * @brief Serialize a frame at the back of the queue, applying the drop policy if needed
+ *
+ * @param frame the frame to be sent, its counter is overwritten when sent
+ * @param key frames pushed with the same key coalesce with LH_TX_COALESCE policy
+ * @param isUrgent the frame is sent before the other frames not sent yet
+ * @return LoRaHomeTxSlot* the slot of the frame, nullptr if the frame is dropped
+ */
+LoRaHomeTxSlot* LoRaHomeTxQueue::push(LoRaHomeFrame& frame, uint8_t key, bool isUrgent)
+{
+    LoRaHomeTxSlot* slot = nullptr;
+    int8_t index = -1;
+
+    if ((LH_TX_COALESCE == mDropPolicy) && (LH_TX_NO_KEY != key))
+    {
+        index = findPending(key);
+        if (0 <= index)
+        {
+            // keep the position in the queue, only refresh the content
+            slot = at(index);
+            mDroppedCount++;
+        }
+    }
+
+    if ((nullptr == slot) && isFull())
+    {
+        if ((LH_TX_DROP_NEWEST == mDropPolicy) || !removeAt(findPending(LH_TX_NO_KEY)))
+        {
+            mDroppedCount++;
+            return nullptr;
+        }
+        mDroppedCount++;
+    }
+
+    if (nullptr == slot)
+    {
+        slot = &mSlots[mOrder[mCount]];
+        index = mCount;
+        mCount++;
+    }
+    if (isUrgent)
+    {
+        moveToFront(index);
+    }
+
+    slot->size = frame.serialize(slot->data);
+    slot->key = key;
+    slot->isSent = false;
+    slot->isDone = false;
+    slot->isAcked = false;
+    slot->retries = 0;
+    slot->isDue = false;
+    slot->isInBurst = false;
+    slot->isAdrRequest = false;
+    return slot;
+}
+
+/**
+ * @brief Get the oldest frame of the queue
+ *
+ * @return LoRaHomeTxSlot* nullptr if the queue is empty
+ */
+LoRaHomeTxSlot* LoRaHomeTxQueue::front()
+{
+    return at(0);
+}
+
+/**
+ * @brief Get a frame of the queue
+ *
+ * @param index 0 for the oldest frame
+ * @return LoRaHomeTxSlot* nullptr if out of range
+ */
+LoRaHomeTxSlot* LoRaHomeTxQueue::at(uint8_t index)
+{
+    if (index >= mCount)
+    {
+        return nullptr;
+    }
+    return &mSlots[mOrder[index]];
+}
+
+/**
+ * @brief Remove the oldest frame of the queue
+ *
+ */
+void LoRaHomeTxQueue::pop()
+{
+    removeAt(0);
+}
+
+/**
+ * @brief Remove all the frames
+ *
+ */
+void LoRaHomeTxQueue::clear()
+{
+    mCount = 0;
+}
+
+/**
+ * @brief Remove a frame, the slot is recycled at the back of the order list
+ *
+ * @param index position of the frame in the queue
+ * @return true if removed
+ * @return false if index is out of range
+ */
+bool LoRaHomeTxQueue::removeAt(uint8_t index)
+{
+    if (index >= mCount)
+    {
+        return false;
+    }
+    uint8_t slotIndex = mOrder[index];
+    for (uint8_t i = index; i < LH_TX_QUEUE_SIZE - 1; i++)
+    {
+        mOrder[i] = mOrder[i + 1];
+    }
+    mOrder[LH_TX_QUEUE_SIZE - 1] = slotIndex;
+    mCount--;
+    return true;
+}
+
+/**
+ * @brief Move a frame not sent yet before all the other frames not sent yet
+ *
+ * @param index position of the frame in the queue
+ */
+void LoRaHomeTxQueue::moveToFront(uint8_t index)
+{
+    int8_t front = findPending(LH_TX_NO_KEY);
+    if ((0 > front) || (index <= front))
+    {
+        return;
+    }
+    uint8_t slotIndex = mOrder[index];
+    for (uint8_t i = index; i > front; i--)
+    {
+        mOrder[i] = mOrder[i - 1];
+    }
+    mOrder[front] = slotIndex;
+}
+
+/**
+ * @brief Find the oldest frame not sent yet
+ *
+ * @param key LH_TX_NO_KEY to match any frame
+ * @return int8_t position of the frame in the queue, -1 if none
+ */
+int8_t LoRaHomeTxQueue::findPending(uint8_t key)
+{
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        LoRaHomeTxSlot* slot = at(i);
+        if (!slot->isSent && ((LH_TX_NO_KEY == key) || (slot->key == key)))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,85 @@
+#ifndef LORAHOMETXQUEUE_H
+#define LORAHOMETXQUEUE_H
+
+#include <Arduino.h>
+#include <loRaOverlay/LoRaHomeFrame.h>
+#include <loRaOverlay/LoraConfig.h>
+
+// Policy applied when a frame is pushed in a full queue.
+// Frames already sent (waiting for their ack) are never dropped.
+const uint8_t LH_TX_DROP_OLDEST = 0;   // drop the oldest frame not sent yet
+const uint8_t LH_TX_DROP_NEWEST = 1;   // reject the pushed frame
+const uint8_t LH_TX_COALESCE = 2;      // replace the pending frame with the same key, else drop the oldest
+
+// Key of a frame that shall never be coalesced
+const uint8_t LH_TX_NO_KEY = 0xFF;
+
+struct LoRaHomeTxSlot
+{
+    uint8_t size;
+    uint8_t key;
+    bool isSent;
+    // acked or given up
+    bool isDone;
+    // done with the ack of the gateway
+    bool isAcked;
+    uint8_t retries;
+    // in flight, to be sent again by the next burst
+    bool isDue;
+    // sent with LH_MSG_FLAG_MORE, timed from the end of its burst
+    bool isInBurst;
+    // carries the radio settings requested by the ADR
+    bool isAdrRequest;
+    // end of the last transmission, in ms
+    unsigned long sentTime;
+    uint8_t data[LH_FRAME_MAX_SIZE];
+};
+
+// Notified when a frame leaves the Tx queue, to learn what the gateway received
+class LoRaHomeTxListener
+{
+public:
+    virtual ~LoRaHomeTxListener() = default;
+
+    /**
+     * @brief Called when a sent frame is removed from the Tx queue
+     *
+     * @param key the key the frame was pushed with
+     * @param isAcked true if acked by the gateway, false if given up
+     */
+    virtual void onTxReleased(uint8_t key, bool isAcked) = 0;
+};
+
+// Fixed capacity FIFO of serialized frames waiting to be sent to the gateway.
+// Frames are stored serialized, the counter is assigned when the frame is sent for the first time.
+class LoRaHomeTxQueue
+{
+public:
+    LoRaHomeTxQueue(uint8_t dropPolicy = LH_TX_QUEUE_DROP_POLICY);
+    virtual ~LoRaHomeTxQueue() = default;
+
+    LoRaHomeTxSlot* push(LoRaHomeFrame& frame, uint8_t key = LH_TX_NO_KEY, bool isUrgent = false);
+    LoRaHomeTxSlot* front();
+    LoRaHomeTxSlot* at(uint8_t index);
+    void pop();
+    void clear();
+
+    inline uint8_t size() const { return mCount; };
+    inline bool isEmpty() const { return 0 == mCount; };
+    inline bool isFull() const { return LH_TX_QUEUE_SIZE == mCount; };
+    inline uint16_t getDroppedCount() const { return mDroppedCount; };
+
+protected:
+    bool removeAt(uint8_t index);
+    void moveToFront(uint8_t index);
+    int8_t findPending(uint8_t key);
+
+    uint8_t mDropPolicy;
+    // mOrder[0..mCount[ are the indexes in mSlots, from the oldest to the newest frame
+    uint8_t mOrder[LH_TX_QUEUE_SIZE];
+    uint8_t mCount;
+    uint16_t mDroppedCount;
+    LoRaHomeTxSlot mSlots[LH_TX_QUEUE_SIZE];
+};
+
+#endif
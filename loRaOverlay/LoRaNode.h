@@ -4,6 +4,8 @@
 #include <ArduinoJson.h>
 #include <Arduino.h>
 
+class LoRaHomeTelemetry;
+
 #define ARDUINO_NANO_BOARD
 
 class LoRaNode
@@ -44,6 +46,15 @@ public:
     */
   virtual bool parseJsonRxPayload(JsonDocument& payload) = 0;
 
+  /**
+   * @brief Get the report by exception telemetry of the node, if any.
+   * The payload of getJsonTxPayload is then completed with the fields out of their deadband,
+   * and nothing is sent while none is. The transmission now flag forces a keyframe.
+   *
+   * @return LoRaHomeTelemetry* the telemetry, nullptr by default
+   */
+  virtual LoRaHomeTelemetry* getTelemetry() { return nullptr; }
+
   uint8_t getNodeId();
   unsigned long getTransmissionTimeInterval();
   void setTransmissionTimeInterval(unsigned long timeInterval);
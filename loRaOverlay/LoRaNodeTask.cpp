@@ -0,0 +1,116 @@
+#include "LoRaNodeTask.h"
+#include <loRaOverlay/LoRaHomeTelemetry.h>
+
+/**
+ * @brief Construct a new LoRaNodeTask, the app is processed and transmits at the first run
+ *
+ * @param node the app
+ * @param loRaHome the radio of the app
+ * @param pollPeriod max delay between two radio polls in ms
+ */
+LoRaNodeTask::LoRaNodeTask(LoRaNode& node, LoRaHomeNode& loRaHome, unsigned long pollPeriod):
+    mNode(node),
+    mLoRaHome(loRaHome),
+    mPollPeriod(pollPeriod),
+    mLastProcessingTime(0),
+    mLastTransmissionTime(0),
+    mIsProcessingBusy(true)
+{
+    mNode.setTransmissionNowFlag(true);
+    // the telemetry commits the fields once acked
+    if (nullptr != mNode.getTelemetry())
+    {
+        mLoRaHome.setTxListener(mNode.getTelemetry());
+    }
+}
+
+/**
+ * @brief Poll the radio, then run what is due: app processing, transmission, retry
+ *
+ * @param now current time in ms
+ * @return unsigned long delay until the next due job, at most the poll period while the radio listens
+ */
+unsigned long LoRaNodeTask::run(unsigned long now)
+{
+    JsonDocument rxPayload;
+    if (mLoRaHome.receiveLoraMessage(rxPayload))
+    {
+        mNode.parseJsonRxPayload(rxPayload);
+    }
+
+    if (mIsProcessingBusy || (now - mLastProcessingTime >= mNode.getProcessingTimeInterval()))
+    {
+        mIsProcessingBusy = mNode.appProcessing();
+        mLastProcessingTime = now;
+    }
+
+    bool isNow = mNode.getTransmissionNowFlag();
+    if (isNow || (now - mLastTransmissionTime >= mNode.getTransmissionTimeInterval()))
+    {
+        mNode.setTransmissionNowFlag(false);
+        sendTxPayload(isNow);
+        mLastTransmissionTime = now;
+    }
+    else if (mLoRaHome.isWaitingForAck() && (0 == mLoRaHome.getNextRetryDelay()))
+    {
+        // the node times each frame in flight from its own transmission
+        mLoRaHome.retrySendToGateway();
+    }
+
+    if (mIsProcessingBusy || mNode.getTransmissionNowFlag())
+    {
+        return 0;
+    }
+    // the radio is only polled while it listens
+    unsigned long delay = mLoRaHome.isRadioSleeping() ? mLoRaHome.getNextRxWindowDelay() : mPollPeriod;
+    unsigned long remaining = getRemaining(now, mLastProcessingTime, mNode.getProcessingTimeInterval());
+    if (remaining < delay)
+    {
+        delay = remaining;
+    }
+    remaining = getRemaining(now, mLastTransmissionTime, mNode.getTransmissionTimeInterval());
+    if (remaining < delay)
+    {
+        delay = remaining;
+    }
+    if (mLoRaHome.isWaitingForAck())
+    {
+        remaining = mLoRaHome.getNextRetryDelay();
+        if (remaining < delay)
+        {
+            delay = remaining;
+        }
+    }
+    return delay;
+}
+
+/**
+ * @brief Send the payload of the app, through its telemetry if any
+ *
+ * @param isNow transmission forced by the app, a telemetry keyframe is sent
+ */
+void LoRaNodeTask::sendTxPayload(bool isNow)
+{
+    JsonDocument payload = mNode.getJsonTxPayload();
+    LoRaHomeTelemetry* telemetry = mNode.getTelemetry();
+    if (nullptr == telemetry)
+    {
+        mLoRaHome.sendToGateway(payload);
+        return;
+    }
+    if (telemetry->buildPayload(payload, isNow))
+    {
+        mLoRaHome.sendToGateway(payload, telemetry->getTxKey());
+    }
+}
+
+/**
+ * @brief Get the time left before an interval elapses, wraparound safe
+ *
+ * @return unsigned long 0 if elapsed
+ */
+unsigned long LoRaNodeTask::getRemaining(unsigned long now, unsigned long last, unsigned long interval)
+{
+    unsigned long elapsed = now - last;
+    return (elapsed >= interval) ? 0 : interval - elapsed;
+}
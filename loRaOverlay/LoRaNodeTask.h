@@ -0,0 +1,33 @@
+#ifndef LORANODETASK_H
+#define LORANODETASK_H
+
+#include <loRaOverlay/LoRaNode.h>
+#include <loRaOverlay/LoRaHomeNode.h>
+#include <scheduler/SchedulerTask.h>
+
+// Scheduler adapter of a LoRaNode and its LoRaHomeNode, instead of the millis() comparisons of the sketch:
+// radio polling, app processing, transmission and retries at their own intervals.
+class LoRaNodeTask : public SchedulerTask
+{
+public:
+    LoRaNodeTask(LoRaNode& node, LoRaHomeNode& loRaHome, unsigned long pollPeriod = LH_NODE_POLL_PERIOD);
+    virtual ~LoRaNodeTask() = default;
+
+    unsigned long run(unsigned long now) override;
+    // delays are the time left until the next job, counted from now
+    inline bool isDelayFromNow() const override { return true; };
+
+private:
+    void sendTxPayload(bool isNow);
+    static unsigned long getRemaining(unsigned long now, unsigned long last, unsigned long interval);
+
+    LoRaNode& mNode;
+    LoRaHomeNode& mLoRaHome;
+    unsigned long mPollPeriod;
+    unsigned long mLastProcessingTime;
+    unsigned long mLastTransmissionTime;
+    // appProcessing asked to be called again at once
+    bool mIsProcessingBusy;
+};
+
+#endif
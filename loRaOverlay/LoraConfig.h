@@ -6,6 +6,7 @@
 // LoRa HARDWARE CONFIGURATION
 // -------------------------------------------------------
 //define the pins used by the transceiver module
+// DIO0 is only used with LH_ASYNC_RADIO, it shall then be an external interrupt pin: 2 or 3 on a Uno or a Nano
 
 #ifdef ARDUINO_UNO_BOARD
 #define SS (10)
@@ -46,13 +47,105 @@
 // However, the rise in CR value will also increase the duration for the transmission
 // Supported values are between 5 and 8, these correspond to coding rates of 4/5 and 4/8. The coding rate numerator is fixed at 4
 #define LORA_CODING_RATE_DENOMINATOR 5
+// Tx power in dBm, 2 to 17 on the PA_BOOST pin
+#define LORA_TX_POWER 17
 
-#define ACK_TIMEOUT 2000 // 2000 ms max to receive an Ack before retry to send the message
+// Comment to disable the adaptive data rate: spreading factor and Tx power tuned from the SNR of the acks.
+// LORA_SPREADING_FACTOR and LORA_TX_POWER are then the initial and fallback settings.
+// The spreading factor only changes when the gateway receives all of them (LH_MSG_FLAG_ADR), the Tx power always can.
+#define LH_USE_ADR
+#define LH_ADR_MIN_TX_POWER 2
+#define LH_ADR_MAX_TX_POWER 17
+// number of acks averaged before a decision
+#define LH_ADR_SAMPLE_COUNT 4
+// frames given up without ack before the link is made more robust
+#define LH_ADR_MAX_LOST_ACKS 2
+// frames given up in a row before going back to the default settings
+#define LH_ADR_FALLBACK_LOST_ACKS 6
+// margins in tenths of dB, kept above the demodulation floor of the spreading factor
+#define LH_ADR_INSTALLATION_MARGIN 100
+#define LH_ADR_HYSTERESIS 30
+
+// Number of preamble symbols, same value shall be used by the gateway
+#define LORA_PREAMBLE_LENGTH 8
+// Max airtime over one hour, in per mille. The 868 MHz band is limited to 1% duty cycle in Europe.
+#define LH_DUTY_CYCLE_PERMILLE 10
+
+// Uncomment to drive the radio with DIO0 interrupts: send() doesn't wait for the end of the transmission
+// and frames are received in the background. DIO0 shall be wired to an interrupt capable pin, checked at compile time on AVR.
+// #define LH_ASYNC_RADIO
+// Number of slots of the Rx ring in async mode, one slot is always kept empty
+#define LH_RX_RING_SIZE 3
+
+// Uncomment for battery nodes (as LoRaWAN Class A): the radio sleeps, it only listens during LH_RX_WINDOW_DURATION ms
+// after each transmission, and every LH_RX_WINDOW_PERIOD ms if not 0. Downlinks are only received in these windows.
+// #define LH_CLASS_A
+#define LH_RX_WINDOW_DURATION 1000
+#define LH_RX_WINDOW_PERIOD 0
+
+// Max delay in ms between two polls of the radio by LoRaNodeTask
+#define LH_NODE_POLL_PERIOD 10
+
+#define ACK_TIMEOUT 2000 // 2000 ms max to receive an Ack before retry to send the message, until a round trip time is measured
+#define ACK_TIMEOUT_MIN 200 // bounds of the ack timeout derived from the measured round trip time
+#define ACK_TIMEOUT_MAX 8000
 #define MAX_RETRY_NO_VALID_ACK 3
 
+// Number of frames that can wait to be sent to the gateway, each one uses about LH_FRAME_MAX_SIZE bytes of RAM
+#define LH_TX_QUEUE_SIZE 3
+// Policy when a frame is sent while the queue is full: LH_TX_DROP_OLDEST, LH_TX_DROP_NEWEST or LH_TX_COALESCE
+#define LH_TX_QUEUE_DROP_POLICY LH_TX_DROP_OLDEST
+// Max number of frames in flight when the gateway supports selective acks. 1 to always use stop and wait.
+// Shall not exceed LH_TX_QUEUE_SIZE nor 8 (size of the selective ack bitmap)
+#define LH_TX_WINDOW_SIZE 3
+
 const unsigned int MY_NETWORK_ID = 0xACDC;
 
 #define MSG_SNR "snr"
 #define MSG_RSSI "rssi"
+// capabilities of the node (LH_MSG_FLAG_xxx), sent in the JSON payload until the gateway advertised its own ones in its acks
+#define MSG_CAPABILITIES "cap"
+// radio settings the node will switch to, sent until a frame carrying them is acked
+#define MSG_SPREADING_FACTOR "sf"
+#define MSG_TX_POWER "pw"
+// telemetry fields that moved out of their deadband, as deltas to the last keyframe
+#define MSG_TELEMETRY_DELTA "d"
+// sequence number of the telemetry keyframe, or of the keyframe the deltas refer to
+#define MSG_TELEMETRY_KEYFRAME "k"
+
+// Max number of fields of LoRaHomeTelemetry, 16 at most
+#define LH_TELEMETRY_MAX_FIELDS 8
+// A telemetry keyframe with every field is sent at least every LH_TELEMETRY_KEYFRAME_INTERVAL transmission intervals
+#define LH_TELEMETRY_KEYFRAME_INTERVAL 30
+// array of timestamped readings of LoRaHomeBatch
+#define MSG_BATCH "b"
+
+// Max number of readings of LoRaHomeBatch
+#define LH_BATCH_MAX_READINGS 8
+// A batch is flushed once its oldest reading is LH_BATCH_MAX_AGE ms old
+#define LH_BATCH_MAX_AGE 60000
+// Unit of the reading ages in a batch, in ms
+#define LH_BATCH_TIME_UNIT 100
+// Payload bytes kept for the keys added by LoRaHomeNode (snr, rssi, cap, sf, pw)
+#define LH_BATCH_RESERVED_SIZE 40
+// A batch is flushed once a reading of this size doesn't fit anymore
+#define LH_BATCH_MIN_READING_SIZE 16
+// Number of emitters whose counters are tracked to drop duplicated frames, on the node
+#define LH_DEDUPE_CACHE_SIZE 2
+// Silence in ms after which the counter of an emitter is no longer tracked, longer than the retries of a frame
+#define LH_DEDUPE_TIMEOUT 30000
+// A counter further behind the highest one received can't be a retransmission: the emitter restarted.
+// Not less than LH_TX_WINDOW_SIZE, 32 at most
+#define LH_DEDUPE_MAX_AGE 8
+
+// Number of downlinks LoRaHomeGateway can keep pending, shared by all the nodes
+#define LH_GATEWAY_DOWNLINK_POOL_SIZE 16
+// Max number of frames handled by one call of LoRaHomeGateway::process
+#define LH_GATEWAY_MAX_FRAMES_PER_PROCESS 32
+// A selective ack is deferred while a node sends a burst, until the airtime of the next frame plus this margin in ms
+#define LH_GATEWAY_SACK_MARGIN 100
+
+// Comment to never use MessagePack payloads, even if the gateway supports them
+#define LH_USE_MSGPACK
 
 #endif 
\ No newline at end of file
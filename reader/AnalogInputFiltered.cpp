@@ -4,7 +4,8 @@
 AnalogInputFiltered::AnalogInputFiltered(int pin) :
   mPin(pin),
   mNumberOfDataBuffered(0),
-  mIndex(0)
+  mIndex(0),
+  mTotal(0)
 {
   for (int i = 0; i < NUMBER_VALUE_AVERAGE; i++) {
     mValue[i] = 0;
@@ -12,26 +13,18 @@ AnalogInputFiltered::AnalogInputFiltered(int pin) :
 }
 
 int AnalogInputFiltered::Get() {
-  unsigned long total(0);
-  int result(0);
-
-  for (int i = 0; i < mNumberOfDataBuffered; i++) {
-    total += mValue[i];
-  }
-
-  if (0 != total && 0 != mNumberOfDataBuffered) {
-    result = static_cast<int>(total / mNumberOfDataBuffered);
-  }
-
-  if (0 == total) {
-    result = 0;
+  if (0 == mNumberOfDataBuffered) {
+    return 0;
   }
-  return result;
+  return static_cast<int>(mTotal / mNumberOfDataBuffered);
 }
 
 void AnalogInputFiltered::Run() {
+  int value = analogRead(mPin);
 
-  mValue[mIndex] = analogRead(mPin);
+  // Running sum, the value leaving the buffer is 0 until it is filled
+  mTotal += value - mValue[mIndex];
+  mValue[mIndex] = value;
 
   mIndex++;
   if (NUMBER_VALUE_AVERAGE <= mIndex) {
@@ -21,6 +21,8 @@ protected:
 
   int mIndex;
 
+  long mTotal;
+
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "AnalogScanner.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+// Timer 1 clocked at F_CPU / 64
+#define TIMER_PRESCALER 64
+
+// A conversion takes 13.5 ADC clocks, ADC clocked at F_CPU / 128
+#define CONVERSION_TICKS ((14 * 128) / TIMER_PRESCALER)
+
+static AnalogScannerBase *sScanner = nullptr;
+
+#ifdef ANALOG_SCANNER_ADC_ISR
+ISR(ADC_vect)
+{
+  AnalogScannerBase::OnAdcInterrupt();
+}
+#endif
+
+static uint8_t getChannel(uint8_t pin) {
+  return (pin >= A0) ? pin - A0 : pin;
+}
+#endif
+
+AnalogScannerBase::AnalogScannerBase(const uint8_t *pins, uint8_t count) :
+  mPins(pins),
+  mCount(count),
+  mIndex(0),
+  mSampleRate(0),
+  mOverrunCount(0),
+  mTimerControlA(0),
+  mTimerControlB(0),
+  mTimerInterruptMask(0),
+  mTimerCompareA(0),
+  mTimerCompareB(0)
+{
+  if (ANALOG_SCANNER_MAX_CHANNELS < mCount) {
+    mCount = ANALOG_SCANNER_MAX_CHANNELS;
+  }
+  for (int i = 0; i < ANALOG_SCANNER_MAX_CHANNELS; i++) {
+    mLatency[i] = 0;
+  }
+}
+
+bool AnalogScannerBase::Begin(uint16_t sampleRate) {
+#ifdef __AVR__
+  if (0 == mCount || 0 == sampleRate || nullptr != sScanner) {
+    return false;
+  }
+  // The period shall leave room for a conversion and its interrupt
+  uint32_t ticks = F_CPU / TIMER_PRESCALER / sampleRate;
+  if (2 * CONVERSION_TICKS > ticks || 65536UL < ticks) {
+    return false;
+  }
+  sScanner = this;
+  mIndex = 0;
+  mOverrunCount = 0;
+  mSampleRate = F_CPU / TIMER_PRESCALER / ticks;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    mTimerControlA = TCCR1A;
+    mTimerControlB = TCCR1B;
+    mTimerInterruptMask = TIMSK1;
+    mTimerCompareA = OCR1A;
+    mTimerCompareB = OCR1B;
+    // CTC mode, TOP is OCR1A. Compare match B at BOTTOM triggers the
+    // conversion so TCNT1 is the time elapsed since the trigger.
+    TCCR1A = 0;
+    TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+    TIMSK1 = 0;
+    OCR1A = ticks - 1;
+    OCR1B = 0;
+    TCNT1 = 0;
+    TIFR1 = _BV(OCF1B);
+    ADMUX = (ADMUX & (_BV(REFS1) | _BV(REFS0))) | getChannel(mPins[0]);
+    ADCSRB = _BV(ADTS2) | _BV(ADTS0);
+    ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AnalogScannerBase::End() {
+#ifdef __AVR__
+  if (this != sScanner) {
+    return;
+  }
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    // Back to the configuration of the Arduino core for analogRead() and PWM
+    ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+    ADCSRB = 0;
+    TCCR1B = mTimerControlB;
+    TCCR1A = mTimerControlA;
+    OCR1A = mTimerCompareA;
+    OCR1B = mTimerCompareB;
+    // Flags raised while scanning would fire the interrupts of the app at once
+    TIFR1 = _BV(ICF1) | _BV(OCF1B) | _BV(OCF1A) | _BV(TOV1);
+    TIMSK1 = mTimerInterruptMask;
+    sScanner = nullptr;
+  }
+  mSampleRate = 0;
+#endif
+}
+
+void AnalogScannerBase::Run() {
+#ifdef __AVR__
+  // analogRead() would select another channel under the interrupt and its
+  // conversion would be fed to the filters
+  if (this == sScanner) {
+    return;
+  }
+#endif
+  for (uint8_t i = 0; i < mCount; i++) {
+    Add(i, analogRead(mPins[i]));
+  }
+}
+
+uint16_t AnalogScannerBase::GetSampleRate() const {
+  return mSampleRate;
+}
+
+uint16_t AnalogScannerBase::GetOverrunCount() const {
+  uint16_t count;
+#ifdef __AVR__
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    count = mOverrunCount;
+  }
+#else
+  count = mOverrunCount;
+#endif
+  return count;
+}
+
+uint16_t AnalogScannerBase::GetLatency(uint8_t index) const {
+  uint16_t latency;
+#ifdef __AVR__
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    latency = mLatency[index];
+  }
+#else
+  latency = mLatency[index];
+#endif
+  return latency;
+}
+
+void AnalogScannerBase::OnConversion(int value) {
+#ifdef __AVR__
+  uint16_t ticks = TCNT1;
+  // The trigger is the rising edge of the compare flag, clear it for the next
+  TIFR1 = _BV(OCF1B);
+  // Less than a conversion since the trigger: the timer wrapped, this
+  // interrupt is late and the trigger of the period was lost
+  if (CONVERSION_TICKS > ticks) {
+    mOverrunCount++;
+  }
+  uint8_t index = mIndex;
+  mLatency[index] = clockCyclesToMicroseconds((uint32_t)ticks * TIMER_PRESCALER);
+  Add(index, value);
+  index++;
+  if (mCount <= index) {
+    index = 0;
+  }
+  mIndex = index;
+  // Used by the conversion of the next trigger
+  ADMUX = (ADMUX & 0xF0) | getChannel(mPins[index]);
+#endif
+}
+
+void AnalogScannerBase::OnAdcInterrupt() {
+#ifdef __AVR__
+  if (nullptr != sScanner) {
+    sScanner->OnConversion(ADC);
+  }
+#endif
+}
@@ -0,0 +1,116 @@
+#ifndef ANALOG_SCANNER_H
+#define ANALOG_SCANNER_H
+
+#include "Arduino.h"
+#include "Filters.h"
+
+// ADC channels of an ATmega328P
+#define ANALOG_SCANNER_MAX_CHANNELS 8
+
+// Define for the whole build to let the scanner own the ADC complete interrupt
+// (ISR(ADC_vect)). Otherwise the app shall define it and call
+// AnalogScannerBase::OnAdcInterrupt, before Begin().
+// #define ANALOG_SCANNER_ADC_ISR
+
+// Samples a list of analog pins in the background. Timer 1 triggers a
+// conversion at a fixed rate, the ADC complete interrupt feeds the result to
+// the filter of the channel and selects the next channel, round robin. The main
+// loop only reads the filtered values, it never waits for the ADC.
+// Timer 1 is taken over while scanning, PWM on pins 9 and 10 is not available.
+// On targets other than AVR Begin() fails and Run() samples all the channels
+// with analogRead().
+class AnalogScannerBase {
+
+public:
+  AnalogScannerBase(const uint8_t *pins, uint8_t count);
+
+  // sampleRate is the number of conversions per second, shared by the
+  // channels. Return false if the rate is out of range or another scanner
+  // runs. The voltage reference in use is kept: the Arduino core only applies
+  // analogReference() at the next analogRead().
+  bool Begin(uint16_t sampleRate);
+
+  // Timer 1 is restored as it was before Begin()
+  void End();
+
+  // Sample all the channels with analogRead(), does nothing while scanning in
+  // the background
+  void Run();
+
+  uint16_t GetSampleRate() const;
+
+  // Conversions completed after the next trigger, the trigger is lost
+  uint16_t GetOverrunCount() const;
+
+  // Time from the trigger of the last conversion of the channel to its
+  // filtering, in us
+  uint16_t GetLatency(uint8_t index) const;
+
+  // Called by the ADC complete interrupt
+  void OnConversion(int value);
+
+  // Body of ISR(ADC_vect), feeds the conversion to the running scanner
+  static void OnAdcInterrupt();
+
+protected:
+  virtual void Add(uint8_t index, int value) = 0;
+
+  const uint8_t *mPins;
+
+  uint8_t mCount;
+
+  volatile uint8_t mIndex;
+
+  uint16_t mSampleRate;
+
+  volatile uint16_t mOverrunCount;
+
+  volatile uint16_t mLatency[ANALOG_SCANNER_MAX_CHANNELS];
+
+  uint8_t mTimerControlA;
+
+  uint8_t mTimerControlB;
+
+  uint8_t mTimerInterruptMask;
+
+  uint16_t mTimerCompareA;
+
+  uint16_t mTimerCompareB;
+
+};
+
+// Scanner with its own filter state per channel, e.g.
+// AnalogScanner<MovingAverageFilter<3>, 6>
+template <class Filter, uint8_t N>
+class AnalogScanner : public AnalogScannerBase {
+
+public:
+  AnalogScanner(const uint8_t (&pins)[N]) :
+    AnalogScannerBase(pins, N)
+  {
+  }
+
+  int Get(uint8_t index) const {
+    int value;
+    // The filter state is updated by the interrupt
+#ifdef __AVR__
+    uint8_t sreg = SREG;
+    cli();
+    value = mFilter[index].Get();
+    SREG = sreg;
+#else
+    value = mFilter[index].Get();
+#endif
+    return value;
+  }
+
+protected:
+  void Add(uint8_t index, int value) override {
+    mFilter[index].Add(value);
+  }
+
+  Filter mFilter[N];
+
+};
+
+#endif
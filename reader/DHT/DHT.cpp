@@ -8,6 +8,13 @@ written by Adafruit Industries
 
 #define MIN_INTERVAL 2000
 
+// A transfer lasts at most ~5 ms.
+#define EDGE_CAPTURE_TIMEOUT 10
+
+DHT * volatile DHT::_capturing = NULL;
+uint16_t DHT::_edges[DHT_EDGE_BUFFER_SIZE];
+volatile uint8_t DHT::_edgecount = 0;
+
 DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) {
   _pin = pin;
   _type = type;
@@ -19,6 +26,14 @@ DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) {
                                                  // reading pulses from DHT sensor.
   // Note that count is now ignored as the DHT reading algorithm adjusts itself
   // basd on the speed of the processor.
+  _lastresult = false;
+  _laststatus = DHT_ERROR_TIMEOUT;
+  _readcount = 0;
+  _errorcount = 0;
+  _state = DHT_STATE_IDLE;
+  _statetime = 0;
+  _callback = NULL;
+  _edgecapture = false;
 }
 
 void DHT::begin(void) {
@@ -28,6 +43,8 @@ void DHT::begin(void) {
   // >= MIN_INTERVAL right away. Note that this assignment wraps around,
   // but so will the subtraction.
   _lastreadtime = -MIN_INTERVAL;
+  _readcount = 0;
+  _errorcount = 0;
   DEBUG_PRINT("Max clock cycles: "); DEBUG_PRINTLN(_maxcycles, DEC);
 }
 
@@ -36,97 +53,121 @@ float DHT::readTemperature(bool S, bool force) {
   float f = NAN;
 
   if (read(force)) {
-    switch (_type) {
-    case DHT11:
-      f = data[2];
-      if(S) {
-        f = convertCtoF(f);
-      }
-      break;
-    case DHT22:
-    case DHT21:
-      f = data[2] & 0x7F;
-      f *= 256;
-      f += data[3];
-      f *= 0.1;
-      if (data[2] & 0x80) {
-        f *= -1;
-      }
-      if(S) {
-        f = convertCtoF(f);
-      }
-      break;
+    f = decodeTemperature() * 0.1f;
+    if(S) {
+      f = convertCtoF(f);
     }
   }
   return f;
 }
 
 float DHT::convertCtoF(float c) {
-  return c * 1.8 + 32;
+  return c * 1.8f + 32;
 }
 
 float DHT::convertFtoC(float f) {
-  return (f - 32) * 0.55555;
+  return (f - 32) * 0.55555f;
 }
 
 float DHT::readHumidity(bool force) {
   float f = NAN;
-  if (read()) {
-    switch (_type) {
-    case DHT11:
-      f = data[0];
-      break;
-    case DHT22:
-    case DHT21:
-      f = data[0];
-      f *= 256;
-      f += data[1];
-      f *= 0.1;
-      break;
-    }
+  if (read(force)) {
+    f = decodeHumidity() * 0.1f;
   }
   return f;
 }
 
+// Temperature of the last transaction in tenths of degree Celsius.
+int16_t DHT::decodeTemperature(void) {
+  int16_t t = 0;
+  switch (_type) {
+  case DHT11:
+    t = data[2] * 10;
+    break;
+  case DHT22:
+  case DHT21:
+    t = ((uint16_t)(data[2] & 0x7F) << 8) | data[3];
+    if (data[2] & 0x80) {
+      t = -t;
+    }
+    break;
+  }
+  return t;
+}
+
+// Humidity of the last transaction in tenths of percent.
+uint16_t DHT::decodeHumidity(void) {
+  uint16_t h = 0;
+  switch (_type) {
+  case DHT11:
+    h = data[0] * 10;
+    break;
+  case DHT22:
+  case DHT21:
+    h = ((uint16_t)data[0] << 8) | data[1];
+    break;
+  }
+  return h;
+}
+
+DHTReading DHT::readAll(bool force) {
+  read(force);
+  return getReading();
+}
+
+DHTReading DHT::getReading(void) {
+  DHTReading reading;
+  reading.timestamp = _lastreadtime;
+  reading.status = _laststatus;
+  if (_laststatus != DHT_OK) {
+    reading.temperature = 0;
+    reading.humidity = 0;
+    reading.heatIndex = 0;
+    return reading;
+  }
+  reading.temperature = decodeTemperature();
+  reading.humidity = decodeHumidity();
+  reading.heatIndex = dhtComputeHeatIndex(reading.temperature, reading.humidity, false);
+  return reading;
+}
+
 //boolean isFahrenheit: True == Fahrenheit; False == Celcius
+// Computed in fixed point by dhtComputeHeatIndex(), to the nearest tenth.
 float DHT::computeHeatIndex(float temperature, float percentHumidity, bool isFahrenheit) {
-  // Using both Rothfusz and Steadman's equations
-  // http://www.wpc.ncep.noaa.gov/html/heatindex_equation.shtml
-  float hi;
-
-  if (!isFahrenheit)
-    temperature = convertCtoF(temperature);
-
-  hi = 0.5 * (temperature + 61.0 + ((temperature - 68.0) * 1.2) + (percentHumidity * 0.094));
-
-  if (hi > 79) {
-    hi = -42.379 +
-             2.04901523 * temperature +
-            10.14333127 * percentHumidity +
-            -0.22475541 * temperature*percentHumidity +
-            -0.00683783 * pow(temperature, 2) +
-            -0.05481717 * pow(percentHumidity, 2) +
-             0.00122874 * pow(temperature, 2) * percentHumidity +
-             0.00085282 * temperature*pow(percentHumidity, 2) +
-            -0.00000199 * pow(temperature, 2) * pow(percentHumidity, 2);
-
-    if((percentHumidity < 13) && (temperature >= 80.0) && (temperature <= 112.0))
-      hi -= ((13.0 - percentHumidity) * 0.25) * sqrt((17.0 - abs(temperature - 95.0)) * 0.05882);
-
-    else if((percentHumidity > 85.0) && (temperature >= 80.0) && (temperature <= 87.0))
-      hi += ((percentHumidity - 85.0) * 0.1) * ((87.0 - temperature) * 0.2);
+  if (percentHumidity < 0) {
+    percentHumidity = 0;
   }
-
-  return isFahrenheit ? hi : convertFtoC(hi);
+  if (percentHumidity > 100) {
+    percentHumidity = 100;
+  }
+  int16_t t = (int16_t)lround(temperature * 10);
+  uint16_t h = (uint16_t)lround(percentHumidity * 10);
+  return dhtComputeHeatIndex(t, h, isFahrenheit) * 0.1f;
 }
 
 boolean DHT::read(bool force) {
   // Check if sensor was read less than two seconds ago and return early
   // to use last reading.
-  uint32_t currenttime = millis();
-  if (!force && ((currenttime - _lastreadtime) < 2000)) {
+  if (!startRead(force)) {
     return _lastresult; // return last correct measurement
   }
+  // Blocking read for legacy sketches, same timings as the non-blocking one.
+  while (poll() != DHT_STATE_IDLE) {
+    yield();
+  }
+  return _lastresult;
+}
+
+// Start a non-blocking read. Return false if a read is in progress, or if the
+// sensor was read less than two seconds ago (the last result stays valid).
+bool DHT::startRead(bool force) {
+  if (_state != DHT_STATE_IDLE) {
+    return false;
+  }
+  uint32_t currenttime = millis();
+  if (!force && ((currenttime - _lastreadtime) < MIN_INTERVAL)) {
+    return false;
+  }
   _lastreadtime = currenttime;
 
   // Reset 40 bits of received data to zero.
@@ -138,13 +179,148 @@ boolean DHT::read(bool force) {
   // Go into high impedence state to let pull-up raise data line level and
   // start the reading process.
   digitalWrite(_pin, HIGH);
-  delay(250);
+  _state = DHT_STATE_WAKEUP;
+  _statetime = currenttime;
+  return true;
+}
 
-  // First set data line low for 20 milliseconds.
-  pinMode(_pin, OUTPUT);
-  digitalWrite(_pin, LOW);
-  delay(20);
+// Advance the non-blocking read, the delays of the start signal are replaced
+// by timestamps. Return the current state, DHT_STATE_IDLE once done.
+DHTState DHT::poll(void) {
+  uint32_t currenttime = millis();
+  switch (_state) {
+  case DHT_STATE_WAKEUP:
+    if ((currenttime - _statetime) >= 250) {
+      // First set data line low for 20 milliseconds.
+      pinMode(_pin, OUTPUT);
+      digitalWrite(_pin, LOW);
+      _state = DHT_STATE_START;
+      _statetime = currenttime;
+    }
+    break;
+  case DHT_STATE_START:
+    if ((currenttime - _statetime) >= 20) {
+      if (_edgecapture) {
+        if (_capturing != NULL) {
+          break; // Another sensor uses the buffer, hold the start signal.
+        }
+        if (startEdgeCapture()) {
+          _state = DHT_STATE_CAPTURE;
+          _statetime = currenttime;
+          break;
+        }
+      }
+      capture();
+      completeRead();
+    }
+    break;
+  case DHT_STATE_CAPTURE:
+    if (isEdgeCaptureDone() ||
+        ((currenttime - _statetime) >= EDGE_CAPTURE_TIMEOUT)) {
+      stopEdgeCapture();
+      completeRead();
+    }
+    break;
+  default:
+    break;
+  }
+  return _state;
+}
+
+// Count the transaction and notify its result.
+void DHT::completeRead(void) {
+  _state = DHT_STATE_IDLE;
+  _readcount++;
+  if (!_lastresult) {
+    _errorcount++;
+  }
+  if (_callback) {
+    _callback(*this, _lastresult);
+  }
+}
+
+// Set the function called when a non-blocking read completes.
+void DHT::onReadComplete(DHTCallback callback) {
+  _callback = callback;
+}
+
+bool DHT::setEdgeCapture(bool enable) {
+  if (_state != DHT_STATE_IDLE) {
+    return false;
+  }
+  if (enable && (digitalPinToInterrupt(_pin) == NOT_AN_INTERRUPT)) {
+    return false;
+  }
+  _edgecapture = enable;
+  return true;
+}
+
+// Timestamp an edge of the data line. micros() stays accurate as the timer 0
+// overflow is accounted for even with interrupts disabled.
+void DHT::onEdge(void) {
+  if (_edgecount < DHT_EDGE_BUFFER_SIZE) {
+    _edges[_edgecount++] = (uint16_t)micros();
+  }
+}
+
+// Let the interrupt timestamp the transfer then end the start signal, other
+// interrupts keep running. The interrupt is armed first so that a sensor
+// answering during the 40 us high is not missed: the edges before the transfer
+// are skipped by the decoder. Return false, before ending the start signal, if
+// the interrupt is attached by another component.
+bool DHT::startEdgeCapture(void) {
+  uint8_t interrupt = digitalPinToInterrupt(_pin);
+  #if defined(EIFR) && !defined(EICRB)
+    // INTn is interrupt n on these chips, attachInterrupt() enables it.
+    if (EIMSK & _BV(interrupt)) {
+      return false;
+    }
+    // Drop the falling edge of the start signal latched before the interrupt
+    // is attached.
+    EIFR = _BV(interrupt);
+  #endif
+  _capturing = this;
+  _edgecount = 0;
+  attachInterrupt(interrupt, onEdge, CHANGE);
+  // End the start signal by setting data line high for 40 microseconds.
+  digitalWrite(_pin, HIGH);
+  delayMicroseconds(40);
+  pinMode(_pin, INPUT_PULLUP);
+  return true;
+}
+
+// The transfer is over once the line stays released longer than any pulse.
+bool DHT::isEdgeCaptureDone(void) {
+  uint8_t count = _edgecount;
+  if (count >= DHT_EDGE_BUFFER_SIZE) {
+    return true;
+  }
+  if (count < DHT_EDGE_COUNT) {
+    return false;
+  }
+  // The interrupt only writes the slots after count.
+  return (uint16_t)((uint16_t)micros() - _edges[count - 1]) > DHT_EDGE_MAX_PULSE;
+}
+
+bool DHT::stopEdgeCapture(void) {
+  detachInterrupt(digitalPinToInterrupt(_pin));
+  _capturing = NULL;
+  _lastresult = dhtDecodeEdges(_edges, _edgecount, data);
+  if (_lastresult) {
+    _laststatus = DHT_OK;
+  } else if (_edgecount < DHT_EDGE_DATA_COUNT) {
+    _laststatus = DHT_ERROR_TIMEOUT;
+  } else {
+    _laststatus = DHT_ERROR_CHECKSUM;
+  }
+  if (!_lastresult) {
+    DEBUG_PRINT(F("Edge decoding failed, edges: ")); DEBUG_PRINTLN(_edgecount, DEC);
+  }
+  return _lastresult;
+}
 
+// End the start signal and read the 40 bits, the timing critical part.
+bool DHT::capture(void) {
   uint32_t cycles[80];
   {
     // Turn off interrupts temporarily because the next sections are timing critical
@@ -163,11 +339,13 @@ boolean DHT::read(bool force) {
     // for ~80 microseconds again.
     if (expectPulse(LOW) == 0) {
       DEBUG_PRINTLN(F("Timeout waiting for start signal low pulse."));
+      _laststatus = DHT_ERROR_TIMEOUT;
       _lastresult = false;
       return _lastresult;
     }
     if (expectPulse(HIGH) == 0) {
       DEBUG_PRINTLN(F("Timeout waiting for start signal high pulse."));
+      _laststatus = DHT_ERROR_TIMEOUT;
       _lastresult = false;
       return _lastresult;
     }
@@ -193,6 +371,7 @@ boolean DHT::read(bool force) {
     uint32_t highCycles = cycles[2*i+1];
     if ((lowCycles == 0) || (highCycles == 0)) {
       DEBUG_PRINTLN(F("Timeout waiting for pulse."));
+      _laststatus = DHT_ERROR_TIMEOUT;
       _lastresult = false;
       return _lastresult;
     }
@@ -217,11 +396,13 @@ boolean DHT::read(bool force) {
 
   // Check we read 40 bits and that the checksum matches.
   if (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+    _laststatus = DHT_OK;
     _lastresult = true;
     return _lastresult;
   }
   else {
     DEBUG_PRINTLN(F("Checksum failure!"));
+    _laststatus = DHT_ERROR_CHECKSUM;
     _lastresult = false;
     return _lastresult;
   }
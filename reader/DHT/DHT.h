@@ -12,6 +12,9 @@ written by Adafruit Industries
  #include "WProgram.h"
 #endif
 
+#include "DHTDecoder.h"
+#include "DHTMath.h"
+
 
 // Uncomment to enable printing out nice debug messages.
 //#define DHT_DEBUG
@@ -34,6 +37,35 @@ written by Adafruit Industries
 #define DHT21 21
 #define AM2301 21
 
+// States of the non-blocking read.
+typedef enum {
+  DHT_STATE_IDLE = 0,
+  DHT_STATE_WAKEUP,   // data line released high for 250 ms
+  DHT_STATE_START,    // data line pulled low for 20 ms, the start signal
+  DHT_STATE_CAPTURE,  // edges of the transfer timestamped by an interrupt
+} DHTState;
+
+// Result of a bus transaction.
+typedef enum {
+  DHT_OK = 0,
+  DHT_ERROR_TIMEOUT,   // the sensor did not answer or a pulse was missed
+  DHT_ERROR_CHECKSUM,  // the 40 bits were received but are corrupted
+} DHTStatus;
+
+// Values decoded from one bus transaction, in fixed point.
+typedef struct {
+  int16_t temperature;  // tenths of degree Celsius
+  uint16_t humidity;    // tenths of percent
+  int16_t heatIndex;    // tenths of degree Celsius
+  uint32_t timestamp;   // millis() at the start of the transaction
+  DHTStatus status;     // temperature, humidity and heatIndex are 0 on error
+} DHTReading;
+
+class DHT;
+
+// Called by poll() when a non-blocking read completes.
+typedef void (*DHTCallback)(DHT &sensor, bool success);
+
 
 class DHT {
   public:
@@ -46,6 +78,29 @@ class DHT {
    float readHumidity(bool force=false);
    boolean read(bool force=false);
 
+   // Temperature, humidity and heat index from a single bus transaction, the
+   // values of the last one if the sensor was read less than 2 s ago.
+   DHTReading readAll(bool force=false);
+   // Values of the last transaction, e.g. from a read complete callback.
+   DHTReading getReading(void);
+   // Transactions done and failed since begin(), to spot flaky wiring.
+   uint16_t getReadCount(void) const { return _readcount; }
+   uint16_t getErrorCount(void) const { return _errorcount; }
+
+   // Non-blocking read: startRead() then call poll() from the main loop until
+   // it returns DHT_STATE_IDLE. Interrupts are only disabled for the ~5 ms of
+   // the 40 bits capture.
+   bool startRead(bool force=false);
+   DHTState poll(void);
+   void onReadComplete(DHTCallback callback);
+   bool isReading(void) const { return _state != DHT_STATE_IDLE; }
+
+   // Timestamp the edges of the transfer from a pin change interrupt instead
+   // of counting cycles with interrupts disabled. Return false if the pin has
+   // no external interrupt. A read whose interrupt is already attached by
+   // another component, such as a limit switch of an HBridge, counts cycles.
+   bool setEdgeCapture(bool enable);
+
  private:
   uint8_t data[5];
   uint8_t _pin, _type;
@@ -56,8 +111,27 @@ class DHT {
   #endif
   uint32_t _lastreadtime, _maxcycles;
   bool _lastresult;
+  DHTStatus _laststatus;
+  uint16_t _readcount, _errorcount;
+  DHTState _state;
+  uint32_t _statetime;
+  DHTCallback _callback;
+  bool _edgecapture;
+
+  // Only one transfer is captured at a time, the buffer is shared.
+  static DHT * volatile _capturing;
+  static uint16_t _edges[DHT_EDGE_BUFFER_SIZE];
+  static volatile uint8_t _edgecount;
+  static void onEdge(void);
 
   uint32_t expectPulse(bool level);
+  bool capture(void);
+  void completeRead(void);
+  int16_t decodeTemperature(void);
+  uint16_t decodeHumidity(void);
+  bool startEdgeCapture(void);
+  bool isEdgeCaptureDone(void);
+  bool stopEdgeCapture(void);
 
 };
 
@@ -0,0 +1,88 @@
+/* DHT library
+
+MIT license
+written by Adafruit Industries
+*/
+
+#include "DHTArray.h"
+
+#define MIN_INTERVAL 2000
+
+DHTArrayBase::DHTArrayBase(DHT **sensors, uint8_t size) {
+  _sensors = sensors;
+  _size = size;
+  _count = 0;
+  _started = 0;
+  _pending = 0;
+  _valid = 0;
+  _cyclestart = -MIN_INTERVAL;
+}
+
+bool DHTArrayBase::add(DHT &sensor) {
+  if (_count >= _size) {
+    return false;
+  }
+  _sensors[_count++] = &sensor;
+  return true;
+}
+
+void DHTArrayBase::begin(void) {
+  for (uint8_t i = 0; i < _count; ++i) {
+    _sensors[i]->begin();
+  }
+  _cyclestart = millis() - MIN_INTERVAL;
+}
+
+bool DHTArrayBase::startCycle(bool force) {
+  if ((_started != 0) || (_pending != 0)) {
+    return false;
+  }
+  uint32_t currenttime = millis();
+  if (!force && ((currenttime - _cyclestart) < MIN_INTERVAL)) {
+    return false;
+  }
+  _cyclestart = currenttime;
+  _valid = 0;
+  _pending = (1 << _count) - 1;
+  poll();
+  return true;
+}
+
+// Start the sensors whose slot has come and advance the started ones. Return
+// true once all sensors of the cycle are done.
+bool DHTArrayBase::poll(void) {
+  uint32_t elapsed = millis() - _cyclestart;
+  for (uint8_t i = 0; i < _count; ++i) {
+    uint8_t bit = 1 << i;
+    if ((_pending & bit) && (elapsed >= (uint32_t)i * DHT_ARRAY_STAGGER)) {
+      // The array enforces the interval between cycles, a sensor busy with a
+      // read of its own is retried at the next poll.
+      if (_sensors[i]->startRead(true)) {
+        _pending &= ~bit;
+        _started |= bit;
+      }
+    }
+    if ((_started & bit) && (_sensors[i]->poll() == DHT_STATE_IDLE)) {
+      _started &= ~bit;
+      DHTReading reading = _sensors[i]->getReading();
+      if (reading.status == DHT_OK) {
+        _valid |= bit;
+      }
+      store(i, reading);
+    }
+  }
+  return (_started == 0) && (_pending == 0);
+}
+
+uint8_t DHTArrayBase::read(bool force) {
+  if (startCycle(force)) {
+    while (!poll()) {
+      yield();
+    }
+  }
+  uint8_t count = 0;
+  for (uint8_t valid = _valid; valid != 0; valid >>= 1) {
+    count += valid & 1;
+  }
+  return count;
+}
@@ -0,0 +1,87 @@
+/* DHT library
+
+MIT license
+written by Adafruit Industries
+*/
+#ifndef DHT_ARRAY_H
+#define DHT_ARRAY_H
+
+#include "DHT.h"
+
+// Delay between the start of two sensors, in milliseconds. It covers the
+// ~5 ms capture of a sensor so that the captures don't overlap while the
+// 270 ms start signals do.
+#define DHT_ARRAY_STAGGER 6
+
+// Readings of a cycle, one column per field indexed by sensor. Values are in
+// tenths as in DHTReading, status holds a DHTStatus.
+template <uint8_t N>
+struct DHTArrayReadings {
+  int16_t temperature[N];
+  uint16_t humidity[N];
+  uint32_t timestamp[N];
+  uint8_t status[N];
+};
+
+// Reads several sensors in a single cycle of ~270 ms plus 6 ms per sensor,
+// instead of 270 ms per sensor. The tables are sized by DHTArray.
+class DHTArrayBase {
+  public:
+   // Return false if the array is full.
+   bool add(DHT &sensor);
+   void begin(void);
+   uint8_t getCount(void) const { return _count; }
+
+   // Non-blocking cycle: startCycle() then call poll() from the main loop
+   // until it returns true. Return false if a cycle is in progress or if the
+   // last one started less than two seconds ago.
+   bool startCycle(bool force=false);
+   bool poll(void);
+   bool isReading(void) const { return (_started | _pending) != 0; }
+   // Blocking cycle, return the number of sensors read without error.
+   uint8_t read(bool force=false);
+
+ protected:
+  DHTArrayBase(DHT **sensors, uint8_t size);
+  virtual void store(uint8_t index, const DHTReading &reading) = 0;
+
+ private:
+  DHT **_sensors;
+  uint8_t _size, _count;
+  // Bit i of _pending is set until sensor i is started, then bit i of
+  // _started until its read is done.
+  uint8_t _started, _pending;
+  // Bit i is set if sensor i was read without error in the last cycle.
+  uint8_t _valid;
+  uint32_t _cyclestart;
+};
+
+// Array of at most N sensors, N up to 8, e.g. DHTArray<4>.
+template <uint8_t N>
+class DHTArray : public DHTArrayBase {
+  static_assert(N > 0 && N <= 8, "DHTArray handles 1 to 8 sensors");
+
+  public:
+   DHTArray(void) : DHTArrayBase(_slots, N) {
+     memset(&_readings, 0, sizeof(_readings));
+     for (uint8_t i = 0; i < N; ++i) {
+       _readings.status[i] = DHT_ERROR_TIMEOUT;
+     }
+   }
+
+   const DHTArrayReadings<N> &getReadings(void) const { return _readings; }
+
+ protected:
+  void store(uint8_t index, const DHTReading &reading) override {
+    _readings.temperature[index] = reading.temperature;
+    _readings.humidity[index] = reading.humidity;
+    _readings.timestamp[index] = reading.timestamp;
+    _readings.status[index] = reading.status;
+  }
+
+ private:
+  DHT *_slots[N];
+  DHTArrayReadings<N> _readings;
+};
+
+#endif
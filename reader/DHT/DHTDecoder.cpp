@@ -0,0 +1,34 @@
+/* DHT library
+
+MIT license
+written by Adafruit Industries
+*/
+
+#include "DHTDecoder.h"
+
+bool dhtDecodeEdges(const uint16_t *edges, uint8_t count, uint8_t data[5]) {
+  data[0] = data[1] = data[2] = data[3] = data[4] = 0;
+  if (count < DHT_EDGE_DATA_COUNT) {
+    return false;
+  }
+  // Each bit is the low pulse edges[2i]..edges[2i+1] and the high pulse
+  // edges[2i+1]..edges[2i+2] from the first data edge, then edges[80]..edges[81]
+  // is the final low pulse.
+  edges += count - DHT_EDGE_DATA_COUNT;
+  if ((uint16_t)(edges[81] - edges[80]) > DHT_EDGE_MAX_PULSE) {
+    return false;
+  }
+  for (uint8_t i = 0; i < 40; ++i) {
+    const uint16_t *bit = &edges[2*i];
+    uint16_t lowWidth  = bit[1] - bit[0];
+    uint16_t highWidth = bit[2] - bit[1];
+    if ((lowWidth > DHT_EDGE_MAX_PULSE) || (highWidth > DHT_EDGE_MAX_PULSE)) {
+      return false;
+    }
+    data[i/8] <<= 1;
+    if (highWidth > lowWidth) {
+      data[i/8] |= 1;
+    }
+  }
+  return data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF);
+}
@@ -0,0 +1,39 @@
+/* DHT library
+
+MIT license
+written by Adafruit Industries
+*/
+#ifndef DHT_DECODER_H
+#define DHT_DECODER_H
+
+#include <stdint.h>
+
+// Edges of a complete transfer: the 80 us low and 80 us high response (2),
+// 40 bits of one low and one high pulse each (80), the final 50 us low and the
+// release of the line (2).
+#define DHT_EDGE_COUNT 84
+
+// Edges of the 40 bits, the final low pulse and the release of the line, the
+// end of the transfer the decoder aligns on.
+#define DHT_EDGE_DATA_COUNT 82
+
+// Capture buffer: the edges of a complete transfer plus the release of the
+// start signal and a stale interrupt.
+#define DHT_EDGE_BUFFER_SIZE (DHT_EDGE_COUNT + 2)
+
+// Longest pulse accepted, in microseconds (the datasheet ones are <= 80 us).
+#define DHT_EDGE_MAX_PULSE 200
+
+// Decode the 5 bytes sent by the sensor from the timestamps, in microseconds,
+// of the edges of the data line. The last timestamp is the release of the line
+// at the end of the transfer: the last 82 edges are decoded, whatever edges
+// precede them (release of the start signal, sensor response). Timestamps are
+// the low 16 bits of micros(), the differences are correct across a wrap around.
+// Like the cycle counting decoder a bit is a 1 when its high pulse is longer
+// than its 50 us low pulse.
+// Return true if all pulses have a valid width and the checksum matches.
+// This function has no dependency on Arduino so recorded waveforms can be
+// decoded on a host.
+bool dhtDecodeEdges(const uint16_t *edges, uint8_t count, uint8_t data[5]);
+
+#endif
@@ -0,0 +1,94 @@
+/* DHT library
+
+MIT license
+written by Adafruit Industries
+*/
+
+#include "DHTMath.h"
+
+// Divide rounding half away from zero.
+static int16_t divRound(int32_t n, int16_t d) {
+  return (n >= 0) ? (n + d/2) / d : (n - d/2) / d;
+}
+
+int16_t dhtConvertCtoF(int16_t celsius) {
+  return divRound((int32_t)celsius * 18, 10) + 320;
+}
+
+int16_t dhtConvertFtoC(int16_t fahrenheit) {
+  return divRound(((int32_t)fahrenheit - 320) * 5, 9);
+}
+
+// Integer square root.
+static uint16_t isqrt(uint32_t n) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > n) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+// The heat index is computed with the temperature t in fiftieths of
+// Fahrenheit, which represents exactly both tenths of Celsius and tenths of
+// Fahrenheit, and the humidity r in tenths of percent. The result is in tenths
+// of Fahrenheit in Q14.
+//
+// The Rothfusz regression is evaluated as A(t) + r * (B(t) + r * C(t)) where A,
+// B and C are second order polynomials. Their coefficients are scaled by
+// powers of two (QN suffix) so that every product fits in 32 bits for t up to
+// 80 C.
+#define K00_Q14 -6943375L   // -42.379 * 10 * 2^14
+#define K10_Q28 110005668L  //  2.04901523 / 5 * 2^28
+#define K20_Q28 -7342L      // -0.00683783 / 250 * 2^28
+#define K01_Q20 10636054L   //  10.14333127 * 2^20
+#define K11_Q36 -308901483L // -0.22475541 / 50 * 2^36
+#define K21_Q36 33775L      //  0.00122874 / 2500 * 2^36
+#define K02_Q24 -91968L     // -0.05481717 / 10 * 2^24
+#define K12_Q48 480094979L  //  0.00085282 / 500 * 2^48
+#define K22_Q48 -22405L     // -0.00000199 / 25000 * 2^48
+
+static int32_t heatIndexQ14(int32_t t, int32_t r) {
+  // 0.5 * (T + 61.0 + ((T - 68.0) * 1.2) + (RH * 0.094)), in ten-thousandths
+  // of degree F. Scaled by 2^14 / 1000 to tenths in Q14, multiplied rather
+  // than shifted as it can be negative.
+  int32_t simple = 220 * t - 103000L + 47 * r;
+  if (simple <= 790000L) {
+    return ((simple * 256) / 125) * 8;
+  }
+
+  int32_t c = ((((K12_Q48 + K22_Q48 * t) >> 12) * t) >> 12) + K02_Q24;
+  int32_t b = ((((K11_Q36 + K21_Q36 * t) >> 11) * t) >> 5) + K01_Q20;
+  int32_t a = ((((K10_Q28 + K20_Q28 * t) >> 10) * t) >> 4) + K00_Q14;
+  int32_t hi = a + r * ((b + ((r * c) >> 4)) >> 6);
+
+  if ((r < 130) && (t >= 4000) && (t <= 5600)) {
+    // ((13 - RH) * 0.25) * sqrt((17 - |T - 95|) / 17), the root in Q8.
+    int32_t d = (t > 4750) ? t - 4750 : 4750 - t;
+    uint16_t root = isqrt(((uint32_t)(850 - d) << 16) / 850);
+    hi -= ((130 - r) * root) << 4;
+  }
+  else if ((r > 850) && (t >= 4000) && (t <= 4350)) {
+    // ((RH - 85) * 0.1) * ((87 - T) * 0.2)
+    hi += (((r - 850) * (4350 - t)) << 14) / 2500;
+  }
+  return hi;
+}
+
+int16_t dhtComputeHeatIndex(int16_t temperature, uint16_t percentHumidity, bool isFahrenheit) {
+  if (isFahrenheit) {
+    return (heatIndexQ14(temperature * 5L, percentHumidity) + (1L << 13)) >> 14;
+  }
+  int32_t hi = heatIndexQ14(temperature * 9L + 1600, percentHumidity);
+  return ((hi - (320L << 14)) * 5 / 9 + (1L << 13)) >> 14;
+}
@@ -0,0 +1,27 @@
+/* DHT library
+
+MIT license
+written by Adafruit Industries
+*/
+#ifndef DHT_MATH_H
+#define DHT_MATH_H
+
+#include <stdint.h>
+
+// Fixed point conversions and heat index, without any floating point so they
+// stay cheap on an AVR. Temperatures are in tenths of degree, humidity in
+// tenths of percent, results are rounded to the nearest tenth.
+// These functions have no dependency on Arduino and can be checked on a host.
+
+int16_t dhtConvertCtoF(int16_t celsius);
+int16_t dhtConvertFtoC(int16_t fahrenheit);
+
+// Rothfusz and Steadman's equations, in the unit of the temperature.
+// Compared to the double precision formula over the whole DHT22 range, every
+// tenth from -40.0 to 80.0 C and from 0.0 to 100.0 %, the error is at most
+// 0.09 C, or 0.12 F when the temperature is given in Fahrenheit. This includes
+// the 0.05 of the rounding to a tenth. The only exception is an input exactly
+// on the switch to the Rothfusz regression, where the formula is not continuous.
+int16_t dhtComputeHeatIndex(int16_t temperature, uint16_t percentHumidity, bool isFahrenheit=true);
+
+#endif
@@ -0,0 +1,116 @@
+// Benchmark of the heat index on an AVR (Uno, Nano): cycles per call of the fixed point
+// dhtComputeHeatIndex() and of the floating point formula it replaced, counted by Timer1
+// at the CPU clock over a grid of the DHT22 range.
+// The flash of each one is the difference between the sketch sizes reported by the IDE
+// when built with only BENCHMARK_FIXED, then with only BENCHMARK_FLOAT, set to 1.
+// Results are printed on the serial port at 9600 bauds.
+
+#include "DHTMath.h"
+
+#define BENCHMARK_FIXED 1
+#define BENCHMARK_FLOAT 1
+
+// inputs read from volatiles, so that the calls are not folded at compile time
+volatile int16_t sTemperature;
+volatile uint16_t sHumidity;
+volatile int16_t sSink;
+volatile float sFloatSink;
+
+// DHT::computeHeatIndex before the fixed point kernel
+float floatHeatIndex(float temperature, float percentHumidity, bool isFahrenheit) {
+  float hi;
+
+  if (!isFahrenheit)
+    temperature = temperature * 1.8 + 32;
+
+  hi = 0.5 * (temperature + 61.0 + ((temperature - 68.0) * 1.2) + (percentHumidity * 0.094));
+
+  if (hi > 79) {
+    hi = -42.379 +
+             2.04901523 * temperature +
+            10.14333127 * percentHumidity +
+            -0.22475541 * temperature*percentHumidity +
+            -0.00683783 * pow(temperature, 2) +
+            -0.05481717 * pow(percentHumidity, 2) +
+             0.00122874 * pow(temperature, 2) * percentHumidity +
+             0.00085282 * temperature*pow(percentHumidity, 2) +
+            -0.00000199 * pow(temperature, 2) * pow(percentHumidity, 2);
+
+    if((percentHumidity < 13) && (temperature >= 80.0) && (temperature <= 112.0))
+      hi -= ((13.0 - percentHumidity) * 0.25) * sqrt((17.0 - abs(temperature - 95.0)) * 0.05882);
+
+    else if((percentHumidity > 85.0) && (temperature >= 80.0) && (temperature <= 87.0))
+      hi += ((percentHumidity - 85.0) * 0.1) * ((87.0 - temperature) * 0.2);
+  }
+
+  return isFahrenheit ? hi : (hi - 32) * 0.55555;
+}
+
+void printResult(const char* name, uint32_t total, uint16_t count, uint16_t max) {
+  Serial.print(name);
+  Serial.print(": average ");
+  Serial.print(total / count);
+  Serial.print(" cycles, max ");
+  Serial.print(max);
+  Serial.println(" cycles");
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("Heat index benchmark, in C, from -40.0 to 80.0 C and 0.0 to 100.0 %");
+
+  // Timer1 counts the CPU clock, no interrupt. Every call is shorter than its 65536 cycles.
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  TIMSK1 = 0;
+
+  // cost of the measure itself
+  uint16_t start = TCNT1;
+  uint16_t overhead = TCNT1 - start;
+
+#if BENCHMARK_FIXED
+  uint32_t fixedTotal = 0;
+  uint16_t fixedMax = 0;
+#endif
+#if BENCHMARK_FLOAT
+  uint32_t floatTotal = 0;
+  uint16_t floatMax = 0;
+#endif
+  uint16_t count = 0;
+  for (int16_t t = -400; t <= 800; t += 25) {
+    for (uint16_t h = 0; h <= 1000; h += 50) {
+      sTemperature = t;
+      sHumidity = h;
+      uint16_t cycles;
+#if BENCHMARK_FIXED
+      noInterrupts();
+      start = TCNT1;
+      sSink = dhtComputeHeatIndex(sTemperature, sHumidity, false);
+      cycles = TCNT1 - start - overhead;
+      interrupts();
+      fixedTotal += cycles;
+      fixedMax = max(fixedMax, cycles);
+#endif
+#if BENCHMARK_FLOAT
+      noInterrupts();
+      start = TCNT1;
+      sFloatSink = floatHeatIndex(sTemperature * 0.1f, sHumidity * 0.1f, false);
+      cycles = TCNT1 - start - overhead;
+      interrupts();
+      floatTotal += cycles;
+      floatMax = max(floatMax, cycles);
+#endif
+      count++;
+    }
+  }
+
+#if BENCHMARK_FIXED
+  printResult("dhtComputeHeatIndex", fixedTotal, count, fixedMax);
+#endif
+#if BENCHMARK_FLOAT
+  printResult("float formula, int to float conversions included", floatTotal, count, floatMax);
+#endif
+}
+
+void loop() {
+}
@@ -0,0 +1,33 @@
+#ifndef FILTERED_ANALOG_INPUT_H
+#define FILTERED_ANALOG_INPUT_H
+
+#include "Arduino.h"
+#include "Filters.h"
+
+// Analog input smoothed by one of the filters of Filters.h, e.g.
+// FilteredAnalogInput<MovingAverageFilter<3> > or
+// FilteredAnalogInput<MedianFilter<5> >.
+template <class Filter>
+class FilteredAnalogInput {
+
+public:
+  FilteredAnalogInput(int pin) :
+    mPin(pin)
+  {
+  }
+
+  int Get() const {
+    return mFilter.Get();
+  }
+
+  void Run() {
+    mFilter.Add(analogRead(mPin));
+  }
+
+protected:
+  int mPin;
+
+  Filter mFilter;
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stdint.h>
+
+// Streaming filters, Add() and Get() are O(1) except the median Add() which is
+// O(N). The window and the types are template parameters, each channel picks
+// its own. They don't depend on Arduino and can be benchmarked on a host.
+
+// Moving average over a power of two window, N = 1 << SHIFT. The buffer is
+// filled with the first value so the average is a shift from the start.
+// S shall hold N times the largest value.
+template <uint8_t SHIFT, typename T = int, typename S = long>
+class MovingAverageFilter {
+
+  // N and the index are 8 bits wide
+  static_assert(SHIFT < 8, "MovingAverageFilter: SHIFT shall be 7 at most, 128 values");
+
+public:
+  static const uint8_t N = 1 << SHIFT;
+
+  MovingAverageFilter() :
+    mSum(0),
+    mIndex(0),
+    mIsEmpty(true)
+  {
+  }
+
+  void Add(T value) {
+    if (mIsEmpty) {
+      for (uint8_t i = 0; i < N; i++) {
+        mValue[i] = value;
+      }
+      mSum = static_cast<S>(value) << SHIFT;
+      mIsEmpty = false;
+      return;
+    }
+    mSum += value - mValue[mIndex];
+    mValue[mIndex] = value;
+    mIndex = (mIndex + 1) & (N - 1);
+  }
+
+  T Get() const {
+    return static_cast<T>((mSum + (N >> 1)) >> SHIFT);
+  }
+
+  void Reset() {
+    mSum = 0;
+    mIndex = 0;
+    mIsEmpty = true;
+  }
+
+protected:
+  T mValue[N];
+
+  S mSum;
+
+  uint8_t mIndex;
+
+  bool mIsEmpty;
+};
+
+// Exponential moving average, y += (x - y) / 2^SHIFT. The state keeps SHIFT
+// fractional bits so small steps are not lost. S shall hold the largest value
+// shifted by SHIFT.
+template <uint8_t SHIFT, typename T = int, typename S = long>
+class EmaFilter {
+
+  static_assert(SHIFT > 0, "EmaFilter: SHIFT shall be 1 at least, 0 doesn't filter");
+  static_assert(SHIFT < sizeof(S) * 8 - 1, "EmaFilter: SHIFT shall leave room in S for the value");
+
+public:
+  EmaFilter() :
+    mState(0),
+    mIsEmpty(true)
+  {
+  }
+
+  void Add(T value) {
+    if (mIsEmpty) {
+      mState = static_cast<S>(value) << SHIFT;
+      mIsEmpty = false;
+      return;
+    }
+    mState += value - Get();
+  }
+
+  T Get() const {
+    return static_cast<T>((mState + (static_cast<S>(1) << (SHIFT - 1))) >> SHIFT);
+  }
+
+  void Reset() {
+    mState = 0;
+    mIsEmpty = true;
+  }
+
+protected:
+  S mState;
+
+  bool mIsEmpty;
+};
+
+// Median of the last N values, rejects spikes shorter than N / 2 samples. The
+// values are also kept sorted so Get() is O(1). N shall be odd.
+template <uint8_t N, typename T = int>
+class MedianFilter {
+
+  static_assert(1 == (N & 1), "MedianFilter: N shall be odd");
+
+public:
+  MedianFilter() :
+    mIndex(0),
+    mNumberOfDataBuffered(0)
+  {
+  }
+
+  void Add(T value) {
+    uint8_t i;
+    if (mNumberOfDataBuffered < N) {
+      i = mNumberOfDataBuffered++;
+    }
+    else {
+      // Remove the oldest value from the sorted ones.
+      T oldest = mValue[mIndex];
+      i = 0;
+      while (mSorted[i] != oldest) {
+        i++;
+      }
+      for (; i < N - 1; i++) {
+        mSorted[i] = mSorted[i + 1];
+      }
+    }
+    // Insert the new one.
+    while (i > 0 && mSorted[i - 1] > value) {
+      mSorted[i] = mSorted[i - 1];
+      i--;
+    }
+    mSorted[i] = value;
+    mValue[mIndex] = value;
+    mIndex++;
+    if (N <= mIndex) {
+      mIndex = 0;
+    }
+  }
+
+  T Get() const {
+    return (0 == mNumberOfDataBuffered) ? 0 : mSorted[mNumberOfDataBuffered >> 1];
+  }
+
+  void Reset() {
+    mIndex = 0;
+    mNumberOfDataBuffered = 0;
+  }
+
+protected:
+  T mValue[N];
+
+  T mSorted[N];
+
+  uint8_t mIndex;
+
+  uint8_t mNumberOfDataBuffered;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include <Arduino.h>
+#include "PowerManager.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+
+// millis() counter of the Arduino core, advanced by the time slept
+extern volatile unsigned long timer0_millis;
+
+static volatile bool sIsWatchdogFired = false;
+
+#ifdef POWER_MANAGER_WDT_ISR
+ISR(WDT_vect)
+{
+    PowerManager::onWatchdog();
+}
+#endif
+
+// watchdog periods in ms, index is the prescaler
+static const uint16_t WATCHDOG_PERIODS[] = { 16, 32, 64, 125, 250, 500, 1000, 2000, 4000, 8000 };
+
+/**
+ * @brief Power down until the watchdog interrupt, a pin change or a low level interrupt
+ *
+ * @param prescaler 0 (16 ms) to 9 (8 s)
+ * @return true if woken up by the watchdog, the full period is slept
+ */
+static bool powerDown(uint8_t prescaler)
+{
+    uint8_t wdtcsr = _BV(WDIE) | (prescaler & 0x07) | ((prescaler & 0x08) ? _BV(WDP3) : 0);
+    sIsWatchdogFired = false;
+    // ADC draws current even in power down
+    uint8_t adcsra = ADCSRA;
+    ADCSRA = 0;
+    cli();
+    MCUSR &= ~_BV(WDRF);
+    WDTCSR = _BV(WDCE) | _BV(WDE);
+    WDTCSR = wdtcsr;
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+#ifdef sleep_bod_disable
+    sleep_bod_disable();
+#endif
+    sei();
+    sleep_cpu();
+    sleep_disable();
+    wdt_disable();
+    ADCSRA = adcsra;
+    return sIsWatchdogFired;
+}
+
+/**
+ * @brief Sleep in idle mode until any interrupt: timer 0 keeps running, millis() stays right
+ *
+ */
+static void idle()
+{
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+}
+#endif
+
+/**
+ * @brief Construct a new PowerManager
+ *
+ */
+PowerManager::PowerManager():
+    mSleepTime(0),
+    mWakeCount(0)
+{
+}
+
+/**
+ * @brief Sleep up to a duration, in watchdog periods. The watchdog oscillator is within +/-10%.
+ * A pin change or low level interrupt ends the sleep early, the time slept is then underestimated
+ * by at most one watchdog period.
+ *
+ * @param duration max time to sleep in ms, e.g. Scheduler::getNextDelay
+ * @param isRadioActive the radio may receive or is transmitting: its edge triggered interrupt can't
+ * wake up the MCU from power down, so only sleep in idle mode until the next interrupt
+ * @return unsigned long time slept in power down mode in ms
+ */
+unsigned long PowerManager::sleep(unsigned long duration, bool isRadioActive)
+{
+    unsigned long slept(0);
+#ifdef __AVR__
+    if (duration < POWER_MIN_SLEEP)
+    {
+        return 0;
+    }
+    if (isRadioActive)
+    {
+        idle();
+        mWakeCount++;
+        return 0;
+    }
+    // pending serial output would be lost
+    Serial.flush();
+    while (duration - slept >= POWER_MIN_SLEEP)
+    {
+        uint8_t prescaler = sizeof(WATCHDOG_PERIODS) / sizeof(WATCHDOG_PERIODS[0]) - 1;
+        while (WATCHDOG_PERIODS[prescaler] > duration - slept)
+        {
+            prescaler--;
+        }
+        bool isFullPeriod = powerDown(prescaler);
+        mWakeCount++;
+        if (!isFullPeriod)
+        {
+            break;
+        }
+        slept += WATCHDOG_PERIODS[prescaler];
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        timer0_millis += slept;
+    }
+    mSleepTime += slept;
+#endif
+    return slept;
+}
+
+/**
+ * @brief Notify the end of a watchdog period, from ISR(WDT_vect)
+ *
+ */
+void PowerManager::onWatchdog()
+{
+#ifdef __AVR__
+    sIsWatchdogFired = true;
+#endif
+}
+
+/**
+ * @brief Estimate the average current drawn since the start from the typical currents POWER_xxx_CURRENT
+ *
+ * @param uptime time since the start in ms (millis)
+ * @param radioRxTime time spent by the radio in Rx in ms, see LoRaHomeNode::getRadioRxTime
+ * @param radioTxTime time spent by the radio in Tx in ms, see LoRaHomeNode::getRadioTxTime
+ * @return uint32_t average current in uA
+ */
+uint32_t PowerManager::getAverageCurrent(unsigned long uptime, unsigned long radioRxTime, unsigned long radioTxTime) const
+{
+    if (0 == uptime)
+    {
+        return 0;
+    }
+    unsigned long awake = (uptime > mSleepTime) ? uptime - mSleepTime : 0;
+    // in uA.ms, fits in 64 bits for years of uptime
+    uint64_t charge = (uint64_t)awake * POWER_MCU_ACTIVE_CURRENT
+                                    + (uint64_t)mSleepTime * POWER_MCU_SLEEP_CURRENT
+                                    + (uint64_t)radioRxTime * POWER_RADIO_RX_CURRENT
+                                    + (uint64_t)radioTxTime * POWER_RADIO_TX_CURRENT;
+    return (uint32_t)(charge / uptime);
+}
@@ -0,0 +1,53 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+
+// Shorter delays are not worth a sleep, the watchdog period is 16 ms at least
+#ifndef POWER_MIN_SLEEP
+#define POWER_MIN_SLEEP 16
+#endif
+
+// Define for the whole build to let PowerManager own the watchdog interrupt (ISR(WDT_vect)).
+// Otherwise the app shall define it and call PowerManager::onWatchdog, before the first sleep.
+// #define POWER_MANAGER_WDT_ISR
+
+// Typical currents in uA, for the estimation: ATmega328P at 8 MHz 3.3 V, SX1276 at 17 dBm on PA_BOOST
+#ifndef POWER_MCU_ACTIVE_CURRENT
+#define POWER_MCU_ACTIVE_CURRENT 4000
+#endif
+#ifndef POWER_MCU_SLEEP_CURRENT
+#define POWER_MCU_SLEEP_CURRENT 6 // power down, watchdog on, BOD off
+#endif
+#ifndef POWER_RADIO_RX_CURRENT
+#define POWER_RADIO_RX_CURRENT 11000
+#endif
+#ifndef POWER_RADIO_TX_CURRENT
+#define POWER_RADIO_TX_CURRENT 90000
+#endif
+
+// Put the MCU in its deepest sleep until the next deadline of the Scheduler.
+// On AVR: power down mode, woken up by the watchdog (16 ms to 8 s steps), a pin change interrupt or a low level
+// interrupt. Edge triggered INT0/INT1, as the radio DIO0 attached RISING, don't wake it up: while the radio
+// may receive (not LoRaHomeNode::isRadioSleeping) or a transmission is pending, sleep in idle mode instead.
+// millis() is advanced by the time slept, so the timings of the other components stay right.
+// On other targets sleep() returns at once, the main loop keeps polling.
+class PowerManager
+{
+public:
+    PowerManager();
+    virtual ~PowerManager() = default;
+
+    unsigned long sleep(unsigned long duration, bool isRadioActive = false);
+    static void onWatchdog();
+
+    inline unsigned long getSleepTime() const { return mSleepTime; };
+    inline uint32_t getWakeCount() const { return mWakeCount; };
+    uint32_t getAverageCurrent(unsigned long uptime, unsigned long radioRxTime, unsigned long radioTxTime) const;
+
+private:
+    unsigned long mSleepTime;
+    uint32_t mWakeCount;
+};
+
+#endif
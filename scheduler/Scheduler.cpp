@@ -0,0 +1,271 @@
+#include "Scheduler.h"
+
+/**
+ * @brief Construct a new Scheduler without task
+ *
+ */
+Scheduler::Scheduler():
+    mCount(0),
+    mRunningId(-1),
+    mIsRunningChanged(false)
+{
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        mSlots[i].task = nullptr;
+        mSlots[i].deadline = 0;
+        mSlots[i].heapIndex = 0;
+        mHeap[i] = i;
+    }
+    resetStats();
+}
+
+/**
+ * @brief Register a task
+ *
+ * @param task the task, it shall outlive its registration
+ * @param now current time in ms
+ * @param delay delay before the first run in ms
+ * @return int8_t id of the task, -1 if SCHEDULER_MAX_TASKS is reached
+ */
+int8_t Scheduler::add(SchedulerTask& task, unsigned long now, unsigned long delay)
+{
+    int8_t id(-1);
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        if (nullptr == mSlots[i].task)
+        {
+            id = i;
+            break;
+        }
+    }
+    if (0 > id)
+    {
+        return -1;
+    }
+    Slot& slot = mSlots[id];
+    slot.task = &task;
+    slot.deadline = now + delay;
+    slot.stats = SchedulerTaskStats();
+    slot.heapIndex = mCount;
+    mHeap[mCount] = id;
+    mCount++;
+    siftUp(slot.heapIndex);
+    return id;
+}
+
+/**
+ * @brief Unregister a task
+ *
+ * @param id as returned by add
+ * @return true if removed
+ */
+bool Scheduler::remove(int8_t id)
+{
+    if ((0 > id) || (SCHEDULER_MAX_TASKS <= id) || (nullptr == mSlots[id].task))
+    {
+        return false;
+    }
+    if (id == mRunningId)
+    {
+        mIsRunningChanged = true;
+    }
+    removeAt(mSlots[id].heapIndex);
+    return true;
+}
+
+/**
+ * @brief Move the deadline of a task, e.g. to run it now on an event
+ *
+ * @param id as returned by add
+ * @param now current time in ms
+ * @param delay delay before the next run in ms
+ * @return true if rescheduled
+ */
+bool Scheduler::reschedule(int8_t id, unsigned long now, unsigned long delay)
+{
+    if ((0 > id) || (SCHEDULER_MAX_TASKS <= id) || (nullptr == mSlots[id].task))
+    {
+        return false;
+    }
+    if (id == mRunningId)
+    {
+        mIsRunningChanged = true;
+    }
+    Slot& slot = mSlots[id];
+    slot.deadline = now + delay;
+    siftUp(slot.heapIndex);
+    siftDown(slot.heapIndex);
+    return true;
+}
+
+/**
+ * @brief Run the tasks whose deadline is reached, each one at most once
+ *
+ * @param now current time in ms
+ * @return unsigned long delay until the next deadline in ms, see getNextDelay
+ */
+unsigned long Scheduler::run(unsigned long now)
+{
+    for (uint8_t runs = mCount; (0 < runs) && (0 < mCount); runs--)
+    {
+        uint8_t id = mHeap[0];
+        Slot& slot = mSlots[id];
+        if (isBefore(now, slot.deadline))
+        {
+            break;
+        }
+        unsigned long lateness = now - slot.deadline;
+        slot.stats.runCount++;
+        slot.stats.totalLateness += lateness;
+        if (lateness > slot.stats.maxLateness)
+        {
+            slot.stats.maxLateness = lateness;
+        }
+
+        mRunningId = id;
+        mIsRunningChanged = false;
+        unsigned long delay = slot.task->run(now);
+        mRunningId = -1;
+        // the task already removed or rescheduled itself, its slot may even be reused by a new task
+        if (mIsRunningChanged)
+        {
+            continue;
+        }
+        // other tasks may have been added, removed or rescheduled: the task is no longer at the top of the heap
+        if (SCHEDULER_STOP == delay)
+        {
+            removeAt(slot.heapIndex);
+            continue;
+        }
+        if (0 == delay)
+        {
+            // as soon as possible, but at the next call so that the other due tasks run
+            slot.deadline = now + 1;
+        }
+        else if (slot.task->isDelayFromNow())
+        {
+            slot.deadline = now + delay;
+        }
+        else
+        {
+            // drift free: the next deadline follows the previous one, unless it is already missed
+            slot.deadline += delay;
+            if (!isBefore(now, slot.deadline))
+            {
+                slot.stats.overrunCount++;
+                slot.deadline = now + delay;
+            }
+        }
+        // the deadline only moves later
+        siftDown(slot.heapIndex);
+    }
+    return getNextDelay(now);
+}
+
+/**
+ * @brief Get the delay until the next deadline, the main loop can sleep that long
+ *
+ * @param now current time in ms
+ * @return unsigned long delay in ms, 0 if a task is due, SCHEDULER_STOP if there is no task
+ */
+unsigned long Scheduler::getNextDelay(unsigned long now) const
+{
+    if (0 == mCount)
+    {
+        return SCHEDULER_STOP;
+    }
+    unsigned long deadline = mSlots[mHeap[0]].deadline;
+    return isBefore(now, deadline) ? deadline - now : 0;
+}
+
+/**
+ * @brief Get the statistics of a task
+ *
+ * @param id as returned by add
+ * @return const SchedulerTaskStats* nullptr if the task is not registered
+ */
+const SchedulerTaskStats* Scheduler::getStats(int8_t id) const
+{
+    if ((0 > id) || (SCHEDULER_MAX_TASKS <= id) || (nullptr == mSlots[id].task))
+    {
+        return nullptr;
+    }
+    return &mSlots[id].stats;
+}
+
+/**
+ * @brief Reset the statistics of every task
+ *
+ */
+void Scheduler::resetStats()
+{
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        mSlots[i].stats = SchedulerTaskStats();
+    }
+}
+
+void Scheduler::siftUp(uint8_t index)
+{
+    while (0 < index)
+    {
+        uint8_t parent = (index - 1) / 2;
+        if (!isBefore(mSlots[mHeap[index]].deadline, mSlots[mHeap[parent]].deadline))
+        {
+            return;
+        }
+        swap(index, parent);
+        index = parent;
+    }
+}
+
+void Scheduler::siftDown(uint8_t index)
+{
+    while (true)
+    {
+        uint8_t smallest = index;
+        uint8_t left = 2 * index + 1;
+        uint8_t right = left + 1;
+        if ((left < mCount) && isBefore(mSlots[mHeap[left]].deadline, mSlots[mHeap[smallest]].deadline))
+        {
+            smallest = left;
+        }
+        if ((right < mCount) && isBefore(mSlots[mHeap[right]].deadline, mSlots[mHeap[smallest]].deadline))
+        {
+            smallest = right;
+        }
+        if (smallest == index)
+        {
+            return;
+        }
+        swap(index, smallest);
+        index = smallest;
+    }
+}
+
+void Scheduler::swap(uint8_t a, uint8_t b)
+{
+    uint8_t id = mHeap[a];
+    mHeap[a] = mHeap[b];
+    mHeap[b] = id;
+    mSlots[mHeap[a]].heapIndex = a;
+    mSlots[mHeap[b]].heapIndex = b;
+}
+
+/**
+ * @brief Remove the task at a position of the heap, its slot is freed
+ *
+ * @param index position in mHeap
+ */
+void Scheduler::removeAt(uint8_t index)
+{
+    mSlots[mHeap[index]].task = nullptr;
+    mCount--;
+    if (index == mCount)
+    {
+        return;
+    }
+    swap(index, mCount);
+    siftUp(index);
+    siftDown(index);
+}
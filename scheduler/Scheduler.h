@@ -0,0 +1,72 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "SchedulerTask.h"
+
+// Size of the task table, part of the class layout.
+// To be defined for the whole build, e.g. -DSCHEDULER_MAX_TASKS=12
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8
+#endif
+
+// Statistics of a task. Lateness is the delay between the deadline and the actual run, in ms.
+struct SchedulerTaskStats
+{
+    uint32_t runCount;
+    unsigned long maxLateness;
+    // sum of the lateness, to compute the mean jitter
+    unsigned long totalLateness;
+    // runs started after the deadline of the next run: the missed runs are skipped
+    uint16_t overrunCount;
+};
+
+// Statically allocated cooperative scheduler: a binary min-heap of task deadlines.
+// Deadlines compare wraparound safe, with delays shorter than 24 days.
+// The main loop calls run(), then may sleep for getNextDelay().
+// A task may add, remove or reschedule any task from its run(), itself included:
+// removed or rescheduled from its own run(), the delay it returns is ignored.
+class Scheduler
+{
+public:
+    Scheduler();
+    virtual ~Scheduler() = default;
+
+    int8_t add(SchedulerTask& task, unsigned long now, unsigned long delay = 0);
+    bool remove(int8_t id);
+    bool reschedule(int8_t id, unsigned long now, unsigned long delay = 0);
+    unsigned long run(unsigned long now);
+
+    unsigned long getNextDelay(unsigned long now) const;
+    inline bool isEmpty() const { return 0 == mCount; };
+    inline unsigned long getNextDeadline() const { return mSlots[mHeap[0]].deadline; };
+    const SchedulerTaskStats* getStats(int8_t id) const;
+    void resetStats();
+
+private:
+    struct Slot
+    {
+        SchedulerTask* task;
+        unsigned long deadline;
+        // position in mHeap
+        uint8_t heapIndex;
+        SchedulerTaskStats stats;
+    };
+
+    static inline bool isBefore(unsigned long a, unsigned long b) { return (long)(a - b) < 0; };
+    void siftUp(uint8_t index);
+    void siftDown(uint8_t index);
+    void swap(uint8_t a, uint8_t b);
+    void removeAt(uint8_t index);
+
+    Slot mSlots[SCHEDULER_MAX_TASKS];
+    // slot indexes, ordered as a min-heap on their deadline
+    uint8_t mHeap[SCHEDULER_MAX_TASKS];
+    uint8_t mCount;
+    // task being run, -1 outside of run()
+    int8_t mRunningId;
+    // the running task was removed or rescheduled from its own run()
+    bool mIsRunningChanged;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SCHEDULER_TASK_H
+#define SCHEDULER_TASK_H
+
+// Returned by SchedulerTask::run to remove the task from the scheduler
+const unsigned long SCHEDULER_STOP = 0xFFFFFFFFUL;
+
+// Task run by the Scheduler. A task shall return quickly, it is never preempted.
+class SchedulerTask
+{
+public:
+    virtual ~SchedulerTask() = default;
+
+    /**
+     * @brief Run the task once its deadline is reached
+     *
+     * @param now current time in ms
+     * @return unsigned long delay in ms until the next run, from the deadline of this run unless isDelayFromNow.
+     * SCHEDULER_STOP to stop.
+     */
+    virtual unsigned long run(unsigned long now) = 0;
+
+    /**
+     * @brief Tell from when the delays returned by run are counted
+     *
+     * @return false by default: from the deadline of the run, periodic tasks don't drift.
+     * true: from the time of the run, for tasks computing the time left until their own events.
+     */
+    virtual bool isDelayFromNow() const { return false; }
+};
+
+// Adapter calling a method of a component at a fixed period, e.g. PushPullButton::Handle or AnalogInputFiltered::Run
+template <class T>
+class PeriodicTask : public SchedulerTask
+{
+public:
+    typedef void (T::*Method)();
+
+    PeriodicTask(T& component, Method method, unsigned long period):
+        mComponent(component),
+        mMethod(method),
+        mPeriod(period)
+    {
+    }
+    virtual ~PeriodicTask() = default;
+
+    unsigned long run(unsigned long now) override
+    {
+        (mComponent.*mMethod)();
+        return mPeriod;
+    }
+
+    inline void setPeriod(unsigned long period) { mPeriod = period; };
+
+private:
+    T& mComponent;
+    Method mMethod;
+    unsigned long mPeriod;
+};
+
+#endif
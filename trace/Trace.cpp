@@ -0,0 +1,101 @@
+#include <Arduino.h>
+#include "Trace.h"
+
+#if TRACE_LEVEL >= 1
+
+#if (TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) || (TRACE_BUFFER_SIZE > 128)
+#error "TRACE_BUFFER_SIZE shall be a power of two, 128 at most"
+#endif
+
+#ifdef __AVR__
+#include <util/atomic.h>
+#define TRACE_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#else
+#define TRACE_ATOMIC
+#endif
+
+// Longest line printed by drain()
+#define TRACE_LINE_SIZE 20
+
+TraceRecord Trace::sRecords[TRACE_BUFFER_SIZE];
+uint8_t Trace::sHead = 0;
+uint8_t Trace::sCount = 0;
+uint16_t Trace::sLostCount = 0;
+
+void Trace::write(uint8_t event, uint16_t arg)
+{
+    uint16_t time = millis();
+    TRACE_ATOMIC
+    {
+        TraceRecord& record = sRecords[(sHead + sCount) & (TRACE_BUFFER_SIZE - 1)];
+        record.time = time;
+        record.event = event;
+        record.arg = arg;
+        if (sCount < TRACE_BUFFER_SIZE)
+        {
+            sCount++;
+        }
+        else
+        {
+            // the oldest record is overwritten
+            sHead = (sHead + 1) & (TRACE_BUFFER_SIZE - 1);
+            sLostCount++;
+        }
+    }
+}
+
+bool Trace::read(TraceRecord& record)
+{
+    bool isRead = false;
+    TRACE_ATOMIC
+    {
+        if (sCount > 0)
+        {
+            record = sRecords[sHead];
+            sHead = (sHead + 1) & (TRACE_BUFFER_SIZE - 1);
+            sCount--;
+            isRead = true;
+        }
+    }
+    return isRead;
+}
+
+uint8_t Trace::drain(Print& output, uint8_t budget)
+{
+    uint8_t count = 0;
+    TraceRecord record;
+    while (true)
+    {
+        if (output.availableForWrite() < TRACE_LINE_SIZE)
+        {
+            if (0 == budget)
+            {
+                break;
+            }
+            budget--;
+        }
+        if (!read(record))
+        {
+            break;
+        }
+        output.print(record.time);
+        output.print(' ');
+        output.print(record.event, HEX);
+        output.print(' ');
+        output.println(record.arg);
+        count++;
+    }
+    return count;
+}
+
+uint16_t Trace::getLostCount()
+{
+    uint16_t count;
+    TRACE_ATOMIC
+    {
+        count = sLostCount;
+    }
+    return count;
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// 0: traces compiled out, 1: events, 2: events and verbose ones.
+// To be defined for the whole build, e.g. -DTRACE_LEVEL=0
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 1
+#endif
+
+// Records kept until drained, the oldest ones are overwritten. Power of two.
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE 16
+#endif
+
+// Event ids, one range per component
+enum TraceEvent : uint8_t
+{
+    TRACE_HBRIDGE_OPEN = 0x10,
+    TRACE_HBRIDGE_CLOSE,
+    TRACE_HBRIDGE_STOP,
+    TRACE_HBRIDGE_LIMIT_OPEN,
+    TRACE_HBRIDGE_LIMIT_CLOSE,
+    TRACE_HBRIDGE_BLOCKED,       // arg: ms since the start of the motion
+    TRACE_HBRIDGE_INTERRUPT_BUSY, // arg: limit pin whose external interrupt is already attached
+    TRACE_PUSH_PULL_BUTTON_ENABLE = 0x20,
+    TRACE_PUSH_PULL_BUTTON_DISABLE,
+    TRACE_NODE_TX = 0x30,        // arg: counter
+    TRACE_NODE_TX_DROPPED,       // arg: key
+    TRACE_NODE_TX_FAILED,        // arg: counter
+    TRACE_NODE_ACK,              // arg: counter
+    TRACE_NODE_RX,               // arg: counter
+    TRACE_NODE_RX_ERROR,
+    TRACE_NODE_RX_DUPLICATE,     // arg: counter
+    TRACE_NODE_ADR,              // arg: spreading factor << 8 | Tx power
+    TRACE_NODE_INTERRUPT_BUSY,   // arg: DIO0 interrupt, already attached by another component
+};
+
+struct TraceRecord
+{
+    // millis(), low 16 bits
+    uint16_t time;
+    uint8_t event;
+    uint16_t arg;
+};
+
+class Print;
+
+// Library wide ring of binary trace records. write() takes a few cycles and
+// can be called from an interrupt, the records are formatted only when the
+// main loop is idle, by drain() or read().
+#if TRACE_LEVEL >= 1
+class Trace
+{
+public:
+    static void write(uint8_t event, uint16_t arg);
+
+    /**
+     * @brief Pop the oldest record, e.g. to send it by radio
+     *
+     * @return false if there is no record
+     */
+    static bool read(TraceRecord& record);
+
+    /**
+     * @brief Print the records as "time event arg" lines, as long as the output reports room for a line
+     * in availableForWrite(), so that the main loop doesn't block. A Print that doesn't report its room
+     * returns 0 there: give it a budget of records printed anyway, at the cost of blocking.
+     *
+     * @param output e.g. Serial
+     * @param budget records printed when the output reports no room
+     * @return uint8_t number of records printed
+     */
+    static uint8_t drain(Print& output, uint8_t budget = 0);
+
+    // Records overwritten before being drained
+    static uint16_t getLostCount();
+
+private:
+    static TraceRecord sRecords[TRACE_BUFFER_SIZE];
+    static uint8_t sHead;
+    static uint8_t sCount;
+    static uint16_t sLostCount;
+};
+#else
+class Trace
+{
+public:
+    static inline void write(uint8_t, uint16_t) {}
+    static inline bool read(TraceRecord&) { return false; }
+    static inline uint8_t drain(Print&, uint8_t = 0) { return 0; }
+    static inline uint16_t getLostCount() { return 0; }
+};
+#endif
+
+#if TRACE_LEVEL >= 1
+#define TRACE(event, arg) Trace::write((event), (arg))
+#else
+#define TRACE(event, arg) do {} while (0)
+#endif
+
+#if TRACE_LEVEL >= 2
+#define TRACE_VERBOSE(event, arg) Trace::write((event), (arg))
+#else
+#define TRACE_VERBOSE(event, arg) do {} while (0)
+#endif
+
+#endif